@@ -1,3 +1,4 @@
+#include <stdatomic.h>
 #include <furi.h>
 #include <furi_hal.h>
 #include <gui/gui.h>
@@ -8,32 +9,109 @@
 #include <notification/notification.h>
 #include <notification/notification_messages.h>
 #include <storage/storage.h>
-#include <toolbox/stream/stream.h>
-#include <toolbox/stream/file_stream.h>
+#include "lifecounter_features.h"
 #include "lifecounter_icons.h"
+#include "lifecounter_digits.h"
+#include "lifecounter_frame.h"
+#include "lifecounter_game.h"
+#include "lifecounter_power.h"
+#include "lifecounter_energy.h"
+#include "lifecounter_format.h"
+#include "lifecounter_journal.h"
+#include "lifecounter_tables.h"
+#include "lifecounter_turns.h"
+#include "lifecounter_graph.h"
+#include "lifecounter_history.h"
+#include "lifecounter_stress.h"
+#include "lifecounter_worker.h"
+#include "lifecounter_compact.h"
+#include "lifecounter_export.h"
+#include "lifecounter_remote.h"
+#include "lifecounter_trace.h"
+#include "lifecounter_watchdog.h"
+#include "lifecounter_histogram.h"
+#include "lifecounter_memstats.h"
+#include "lifecounter_fault.h"
 
 #define TAG "Lifecounter"
 #define CFG_FILENAME "lifecounter.cfg"
+#define LIFE_TILE_WIDTH 48 // Room for the life total inside the selection frame
+#define CONFIG_BUFFER_SIZE 64 // Fits six int values separated by newlines
+#define CONFIG_VALUES 6
+#define SETTINGS_SAVE_DELAY_MS 2000 // Quiet time after the last settings change before it is saved
 
 static int default_life_values[] = {0, 10, 20, 40, 100};
 static char* default_life_names[] = {"Zero", "Ten", "Twenty", "Forty", "Hundred"};
+#define DEFAULT_LIFE_DEFAULT 20
 static int toggle_state_values[] = {0, 1};
 static char* toggle_states_names[] = {"Off", "On"};
+static int journals_kept_values[] = {10, 25, 50, 100, 0};
+static const uint16_t stall_budgets_ms[] = {8, 16, 33, 50, 100};
+static char* journals_kept_names[] = {"10", "25", "50", "100", "All"};
+#define JOURNALS_KEPT_DEFAULT 25
+#define EXPORT_FILENAME "history.csv"
+#define TRACE_FILENAME "trace.json"
+#define WATCHDOG_FILENAME "stalls.bin"
+#define HISTOGRAM_FILENAME "latency.bin"
+
+#define GRAPH_PANEL_HEIGHT 31 // Two panels and a separator line fill the screen
+#define GRAPH_PANEL_PITCH 33
+#define SPLASH_ICON_ID 0x100 // Frame hash id of the splash image, digit glyphs use ids below it
 
 typedef enum {
     LifecounterSubmenuIndexConfigure,
     LifecounterSubmenuIndexMain,
     LifecounterSubmenuIndexReset,
+    LifecounterSubmenuIndexDiagnostics,
+    LifecounterSubmenuIndexGraph,
+    LifecounterSubmenuIndexExport,
+    LifecounterSubmenuIndexTable,
+    LifecounterSubmenuIndexTurns,
 } LifecounterSubmenuIndex;
 
+// Items of the configuration screen, in the order they are shown.
+typedef enum {
+    LifecounterSettingIndexFormat,
+    LifecounterSettingIndexStartingLife,
+    LifecounterSettingIndexBacklight,
+#if LIFECOUNTER_FEATURE_AUDIO
+    LifecounterSettingIndexAudio,
+#endif
+#if LIFECOUNTER_FEATURE_HISTORY
+    LifecounterSettingIndexJournalsKept,
+#endif
+} LifecounterSettingIndex;
+
 // Each view is a screen we show for the user.
 typedef enum {
     LifecounterViewSplash,
     LifecounterViewSubmenu,
     LifecounterViewConfigure,
     LifecounterViewMain,
+    LifecounterViewDiagnostics,
+    LifecounterViewGraph,
+    LifecounterViewExport,
+    LifecounterViewTurns,
 } LifecounterView;
 
+// Pages of the diagnostics screen, switched with left and right.
+typedef enum {
+    LifecounterDiagnosticsPageMemory,
+    LifecounterDiagnosticsPageRender,
+    LifecounterDiagnosticsPageEvents,
+    LifecounterDiagnosticsPagePower,
+#if LIFECOUNTER_FEATURE_TRACE
+    LifecounterDiagnosticsPageTrace,
+    LifecounterDiagnosticsPageStalls,
+    LifecounterDiagnosticsPageLatency,
+#endif
+#if LIFECOUNTER_FEATURE_HISTORY
+    LifecounterDiagnosticsPageStorage,
+    LifecounterDiagnosticsPageStress,
+#endif
+    LifecounterDiagnosticsPageCount,
+} LifecounterDiagnosticsPage;
+
 typedef enum {
     SoundReset,
     SoundLifeChanged,
@@ -42,29 +120,85 @@ typedef enum {
 
 typedef enum {
     LifecounterEventIdRedrawScreen = 0, // Custom event to redraw the screen
+    LifecounterEventIdSaveSettings = 1, // Custom event to save changed settings
     LifecounterEventIdOkPressed = 42, // Custom event to process OK button getting pressed down
 } LifecounterEventId;
 
+typedef struct {
+    int default_life;
+    uint8_t backlight; // LifecounterPowerProfile
+    bool sound_on;
+    uint8_t format; // LifecounterFormatId, applied when the next game starts
+    int journals_kept; // Journals of finished games kept before they are compacted, 0 keeps all
+    uint8_t table; // Table shown, the app opens on the table it was closed on
+} LifecounterSettings;
+
+/**
+ * All state owned by the application lives in this single block which is allocated once at startup.
+ * Scratch buffers for drawing and configuration I/O are carved out of it as well, so that after
+ * startup the game loop runs without touching the heap.
+ */
 typedef struct {
     ViewDispatcher* view_dispatcher; // View switcher
-    NotificationApp* notifications; // Used for controlling the backlight
+    NotificationApp* notifications; // Notification record, held open for the lifetime of the app
     Submenu* submenu;
     VariableItemList* variable_item_list_settings;
     View* view_main;
+    View* view_turns;
+#if LIFECOUNTER_FEATURE_SPLASH
     View* splash_screen;
+#endif
+#if LIFECOUNTER_FEATURE_DIAGNOSTICS
+    View* view_diagnostics;
+#endif
+#if LIFECOUNTER_FEATURE_HISTORY
+    View* view_graph;
+    View* view_export;
+#endif
 
     FuriTimer* timer; // Timer for redrawing the screen
+    atomic_bool redraw_pending; // A redraw event is queued in the dispatcher and not yet handled
+    atomic_uint redraws_requested; // Redraws asked for by the timer
+    atomic_uint redraws_queued; // Redraw events actually sent to the dispatcher
+    atomic_uint redraws_executed; // Redraw events handled, written by the dispatcher thread
+    Storage* storage; // Storage record, held open for the lifetime of the app
+    File* config_file; // File handle reused for reading and writing the configuration and the saved graph
+
+    LifecounterSettings settings; // Configuration, only touched by the dispatcher thread
+    LifecounterSettings settings_on_card; // Settings as last read from or written to the card
+    FuriTimer* settings_timer; // Saves changed settings once they have been left alone for a while
+    LifecounterTables tables; // Game of every table, owned by the dispatcher thread and published to the renderer
+    LifecounterPower power; // Backlight controller, only touched by the dispatcher thread
+#if LIFECOUNTER_FEATURE_HISTORY
+    LifecounterGraph graph; // Life over time of the table shown, appended by the dispatcher thread and drawn by the graph view
+    LifecounterHistory history; // Finished matches, only touched by the dispatcher thread
+    bool graph_stale; // The graph isn't of the table shown, loaded from its file and journal when shown
+    LifecounterCompaction compaction; // Folds old journals into curves, runs on the worker
+    LifecounterExport exporter; // CSV export of the history, runs on the worker
+#endif
+#if LIFECOUNTER_FEATURE_HISTORY || LIFECOUNTER_FEATURE_TRACE
+    LifecounterWorker worker; // Low priority thread for storage housekeeping
+#endif
+    LifecounterDigitsLayout life_layout[2]; // Glyph placement of the life totals, owned by the draw callback
+#if LIFECOUNTER_FEATURE_DIAGNOSTICS
+    LifecounterDigitsLayout golden_layout[2]; // Glyph placement for the golden frame check
+    uint8_t diagnostics_page; // LifecounterDiagnosticsPage shown on the diagnostics screen
+    uint8_t golden_passed; // Golden frames matching at the last check
+    LifecounterRemote remote; // CLI command for driving and timing the app from a host
+    atomic_bool overlay_on; // Performance overlay shown on the main view, toggled with a long back press
+    uint32_t overlay_window_tick; // Start of the window the redraw rate is counted over, owned by the draw callback
+    uint32_t overlay_window_frames; // Frames drawn before the window started
+    uint32_t overlay_redraw_rate; // Redraws per second over the last complete window
+#if LIFECOUNTER_FEATURE_TRACE
+    LifecounterTraceDump trace_dump; // Trace saved from the diagnostics screen, runs on the worker
+#endif
+#if LIFECOUNTER_FEATURE_HISTORY
+    LifecounterStress stress; // Persistence stress simulator started from the diagnostics screen
+#endif
+#endif
+    char config_buffer[CONFIG_BUFFER_SIZE]; // Scratch buffer for configuration I/O
 } LifecounterApp;
 
-typedef struct {
-    int default_life;
-    uint8_t selected_player;
-    int player_1_life;
-    int player_2_life;
-    bool backlight_on;
-    bool sound_on;
-} LifecounterModel;
-
 /**
  * Callback for exiting the application.
  *
@@ -83,13 +217,16 @@ static uint32_t navigation_exit_callback(void* _context) {
 */
 static uint32_t navigation_submenu_callback(void* _context) {
     UNUSED(_context);
+    memstats_set_phase(LifecounterPhaseMenu);
     return LifecounterViewSubmenu;
 }
 
+#if LIFECOUNTER_FEATURE_SPLASH
 static uint32_t navigation_main_callback(void* _context) {
     UNUSED(_context);
     return LifecounterViewMain;
 }
+#endif
 
 /**
  * Make some noise party people!
@@ -98,24 +235,30 @@ static uint32_t navigation_main_callback(void* _context) {
  * @param      duration   The duration of the beep sound.
  * @param      volume     The volume of the beep sound.
  */
+#if LIFECOUNTER_FEATURE_AUDIO
 static void beep(float frequency, float duration, float volume) {
+    uint32_t trace_start = trace_begin();
     uint32_t timeout = 500;
     if(furi_hal_speaker_acquire(timeout)) {
         furi_hal_speaker_start(frequency, volume);
         furi_delay_ms(duration);
         furi_hal_speaker_stop();
         furi_hal_speaker_release();
+        energy_count_speaker_ms((uint32_t)duration);
     }
+    trace_end(TracePointBeep, trace_start);
 }
+#endif
 
 /**
  * Play audio.
  *
- * @param      model  Model to check whether sounds are on.
- * @param      sound  The sound we want to play.
+ * @param      settings  Settings to check whether sounds are on.
+ * @param      sound     The sound we want to play.
  */
-static void audio_feedback(LifecounterModel* model, LifecounterSound sound) {
-    if (!model->sound_on) {
+static void audio_feedback(LifecounterSettings* settings, LifecounterSound sound) {
+#if LIFECOUNTER_FEATURE_AUDIO
+    if (!settings->sound_on) {
         return;
     }
 
@@ -132,94 +275,427 @@ static void audio_feedback(LifecounterModel* model, LifecounterSound sound) {
     default:
         break;
     }
+#else
+    UNUSED(settings);
+    UNUSED(sound);
+#endif
+}
+
+/**
+* Find the index of a value in an array
+*/
+int find_index( const int a[], int size, int value )
+{
+    int index = 0;
+    while ( index < size && a[index] != value ) ++index;
+    return ( index == size ? -1 : index );
 }
 
 /**
  * Write the configuration to a file.
+ *
+ * @return     true if all of it was written.
  */
-void write_config(LifecounterModel* model) {
-    int life = model->default_life;
-    int backlight = model->backlight_on;
-    int sound = model->sound_on;
+bool write_config(LifecounterApp* app) {
+    LifecounterSettings* settings = &app->settings;
     const char* path = APP_DATA_PATH(CFG_FILENAME);
+    uint32_t trace_start = trace_begin();
 
     FURI_LOG_D(TAG, "Saving configuration to %s", path);
-
-    Storage* storage = furi_record_open(RECORD_STORAGE);
-    File* file = storage_file_alloc(storage);
-
-    FuriString* settings = furi_string_alloc();
-    furi_string_printf(settings, "%d\n%d\n%d\n", life, backlight, sound);
-    const char* buffer = furi_string_get_cstr(settings);
-
-    if(!storage_file_open(file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+    LifecounterPhase previous_phase = memstats_set_phase(LifecounterPhaseSave);
+
+    bool saved = false;
+    int length = snprintf(
+        app->config_buffer,
+        sizeof(app->config_buffer),
+        "%d\n%d\n%d\n%d\n%d\n%d\n",
+        settings->default_life,
+        settings->backlight,
+        settings->sound_on,
+        settings->format,
+        settings->journals_kept,
+        settings->table);
+
+    if(storage_file_open(app->config_file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        // A short write is continued, the card may take the rest on the next call
+        size_t written = 0;
+        while(written < (size_t)length) {
+            size_t chunk =
+                storage_file_write(app->config_file, app->config_buffer + written, length - written);
+            if(!chunk) {
+                break;
+            }
+            written += chunk;
+        }
+        energy_count_sd_written(written);
+        if(written < (size_t)length) {
+            // read_config() drops the incomplete line, that setting falls back to its default
+            FURI_LOG_E(TAG, "Failed to write to file, %zu of %d bytes written", written, length);
+        } else {
+            FURI_LOG_T(TAG, "Configuration saved - (%s)", app->config_buffer);
+            saved = true;
+        }
+    } else {
         FURI_LOG_E(TAG, "Failed to open file: %s", path);
     }
-    if(!storage_file_write(file, buffer, strlen(buffer))) {
-        FURI_LOG_E(TAG, "Failed to write to file");
-    }
 
-    FURI_LOG_T(TAG, "Configuration saved - (%s)", buffer);
-
-    storage_file_close(file);
-    storage_file_free(file);
-    furi_string_free(settings);
-    furi_record_close(RECORD_STORAGE);
+    memstats_sample();
+    storage_file_close(app->config_file);
+    memstats_set_phase(previous_phase);
+    trace_end(TracePointWriteConfig, trace_start);
+    return saved;
 }
 
 /**
  * Read the configuration from a file.
  */
-LifecounterModel* read_config(LifecounterModel* model) {
-    Storage* storage = furi_record_open(RECORD_STORAGE);
-    Stream* stream = file_stream_alloc(storage);
+void read_config(LifecounterApp* app) {
+    LifecounterSettings* settings = &app->settings;
     const char* path = APP_DATA_PATH(CFG_FILENAME);
-    int default_life = 20;
-    bool backlight_on = false;
+    int default_life = DEFAULT_LIFE_DEFAULT;
+    int backlight = PowerProfileAuto;
     bool sound_on = false;
+    int format = FormatIdCustom;
+    int journals_kept = JOURNALS_KEPT_DEFAULT;
+    int table = 0;
+    uint32_t trace_start = trace_begin();
 
     FURI_LOG_D(TAG, "Reading config from %s", path);
 
-    FuriString* line = furi_string_alloc();
-    if(file_stream_open(stream, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
-        for (int i = 0; i < 3; i++) {
-            if(!stream_read_line(stream, line)) {
+    if(storage_file_open(app->config_file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        size_t length =
+            storage_file_read(app->config_file, app->config_buffer, sizeof(app->config_buffer) - 1);
+        app->config_buffer[length] = '\0';
+
+        // One value per line, parsed in place so no line buffer needs to be allocated
+        char* line = app->config_buffer;
+        for (int i = 0; i < CONFIG_VALUES; i++) {
+            // A line without its newline was cut short by a failed write, its value can't be trusted
+            char* newline = strchr(line, '\n');
+            if(!newline) {
                 FURI_LOG_E(TAG, "Failed to read line %d", i);
                 break;
             }
-            int value = atoi(furi_string_get_cstr(line));
+            char* end;
+            int value = strtol(line, &end, 10);
             FURI_LOG_T(TAG, "Read value %d: %d", i, value);
             switch(i) {
             case 0:
                 default_life = value;
                 break;
             case 1:
-                backlight_on = (bool)value;
+                backlight = value;
                 break;
             case 2:
                 sound_on = (bool)value;
                 break;
+            case 3:
+                format = value;
+                break;
+            case 4:
+                journals_kept = value;
+                break;
+            case 5:
+                table = value;
+                break;
             }
+            line = newline + 1;
         }
     } else {
         FURI_LOG_E(TAG, "Failed to open file");
     }
 
-    file_stream_close(stream);
-    stream_free(stream);
-    furi_string_free(line);
-    furi_record_close(RECORD_STORAGE);
+    memstats_sample();
+    storage_file_close(app->config_file);
+
+    FURI_LOG_T(TAG, "Configuration state - Life: %d, Backlight: %d, Sound: %d", default_life, backlight, sound_on);
+
+    // The settings list shows the value by its index, a value that isn't listed has none
+    settings->default_life =
+        find_index(default_life_values, COUNT_OF(default_life_values), default_life) >= 0 ?
+            default_life :
+            DEFAULT_LIFE_DEFAULT;
+    // Older versions stored 0 and 1 for off and on, which map to the same profiles
+    settings->backlight = backlight >= 0 && backlight < PowerProfileCount ? backlight : PowerProfileAuto;
+    settings->sound_on = sound_on;
+    settings->format = format >= 0 && format < FormatIdCount ? format : FormatIdCustom;
+    settings->journals_kept =
+        find_index(journals_kept_values, COUNT_OF(journals_kept_values), journals_kept) >= 0 ?
+            journals_kept :
+            JOURNALS_KEPT_DEFAULT;
+    settings->table = table >= 0 && table < TABLES_COUNT ? table : 0;
+    app->settings_on_card = *settings;
+    trace_end(TracePointReadConfig, trace_start);
+}
+
+static bool settings_equal(const LifecounterSettings* a, const LifecounterSettings* b) {
+    return a->default_life == b->default_life && a->backlight == b->backlight &&
+           a->sound_on == b->sound_on && a->format == b->format && a->journals_kept == b->journals_kept &&
+           a->table == b->table;
+}
+
+/**
+ * Write the settings if they differ from what is on the card.
+ *
+ * @details    A failed write leaves them different, so the next change or the exit tries again.
+ */
+static void settings_save(LifecounterApp* app) {
+    if(settings_equal(&app->settings, &app->settings_on_card)) {
+        return;
+    }
+    if(write_config(app)) {
+        app->settings_on_card = app->settings;
+    }
+}
+
+/**
+ * Called after every settings change, saves once no change has followed for SETTINGS_SAVE_DELAY_MS.
+ */
+static void settings_changed(LifecounterApp* app) {
+    furi_timer_start(app->settings_timer, furi_ms_to_ticks(SETTINGS_SAVE_DELAY_MS));
+}
+
+/**
+ * Callback of the settings timer, the save is left to the dispatcher thread that owns the settings.
+ */
+static void settings_timer_callback(void* context) {
+    LifecounterApp* app = (LifecounterApp*)context;
+    view_dispatcher_send_custom_event(app->view_dispatcher, LifecounterEventIdSaveSettings);
+}
+
+/**
+ * Game of the table shown.
+ */
+static LifecounterGame* app_game(LifecounterApp* app) {
+    return tables_game(&app->tables);
+}
+
+/**
+ * Turn totals of the table shown.
+ */
+static LifecounterTurns* app_turns(LifecounterApp* app) {
+    return &tables_active(&app->tables)->turns;
+}
+
+#if LIFECOUNTER_FEATURE_HISTORY
+/**
+ * Journal of the table shown.
+ */
+static LifecounterJournal* app_journal(LifecounterApp* app) {
+    return &tables_active(&app->tables)->journal;
+}
+
+/**
+ * Save the graph of the table shown as of the latest checkpoint of its journal.
+ *
+ * @details    Called when a checkpoint has just been written, so the graph and the game are those
+ *             of the checkpoint and a resume only replays the operations after it into the graph.
+ */
+static void app_save_graph(LifecounterApp* app) {
+    char path[JOURNAL_PATH_SIZE];
+    LifecounterJournal* journal = app_journal(app);
+    LifecounterGraphMark mark = {
+        .checkpoint = journal->checkpoint,
+        .events = journal->events,
+        .model = *game_live(app_game(app)),
+    };
+
+    if(app->graph_stale) {
+        return;
+    }
+    tables_path(&app->tables, tables_active_index(&app->tables), TABLES_GRAPH_NAME, path, sizeof(path));
+    graph_save(&app->graph, &mark, app->config_file, path);
+}
+#endif
+
+/**
+ * Start the journal, graph and turn totals of a game that was just set up.
+ */
+static void app_start_records(LifecounterApp* app) {
+    turns_reset(app_turns(app));
+#if LIFECOUNTER_FEATURE_HISTORY
+    const LifecounterModel* live = game_live(app_game(app));
+    journal_start(app_journal(app), app->settings.format, live);
+    graph_reset(&app->graph, live->life);
+    app->graph_stale = false;
+    app_save_graph(app);
+#endif
+}
 
-    FURI_LOG_T(TAG, "Configuration state - Life: %d, Backlight: %d, Sound: %d", default_life, backlight_on, sound_on);
+/**
+ * Whether an operation adds a column to the graph, those that don't change a life total don't.
+ */
+static bool app_graphed(uint8_t type) {
+    return type != GameOpSelectNext && type != GameOpNextTurn;
+}
 
-    model->default_life = default_life;
-    model->player_1_life = default_life;
-    model->player_2_life = default_life;
-    model->selected_player = 0;
-    model->backlight_on = backlight_on;
-    model->sound_on = sound_on;
+/**
+ * Apply an operation to the game and record it.
+ *
+ * @return     true if the operation changed the game.
+ */
+static bool app_apply(LifecounterApp* app, const GameOp* op) {
+    LifecounterGame* game = app_game(app);
+    LifecounterModel before = *game_live(game);
+    if(!game_apply(game, op)) {
+        return false;
+    }
 
-    return model;
+    turns_apply(app_turns(app), &before, game_live(game));
+#if LIFECOUNTER_FEATURE_HISTORY
+    LifecounterJournal* journal = app_journal(app);
+    uint32_t checkpoint = journal->checkpoint;
+    journal_append(journal, op, before.selected_player, game_live(game), app_turns(app));
+    // A graph that isn't loaded picks the operation up from the journal once shown
+    if(!app->graph_stale && app_graphed(op->type)) {
+        graph_append(&app->graph, game_live(game)->life);
+    }
+    if(journal->checkpoint != checkpoint) {
+        app_save_graph(app);
+    }
+#endif
+    return true;
+}
+
+#if LIFECOUNTER_FEATURE_HISTORY
+/**
+ * Replay one operation from the journal into the game and turn totals of a table.
+ */
+static void app_replay_event(const LifecounterJournalEvent* event, void* context) {
+    LifecounterTable* table = context;
+    GameOp op = {.type = event->type, .value = event->value};
+    LifecounterModel before = *game_live(&table->game);
+    if(game_apply(&table->game, &op)) {
+        turns_apply(&table->turns, &before, game_live(&table->game));
+    }
+}
+
+/**
+ * Continue the game the last session left in the journal of a table.
+ *
+ * @details    Only the latest checkpoint and the operations after it are read, so resuming takes the
+ *             same time however long the game is. The checkpoint holds the turn totals too.
+ * @return     true if a game was resumed.
+ */
+static bool app_resume_game(LifecounterApp* app, LifecounterTable* table) {
+    LifecounterJournalCheckpoint checkpoint;
+    uint32_t tail;
+    if(!journal_resume(&table->journal, &checkpoint, &tail) || checkpoint.format_id >= FormatIdCount) {
+        return false;
+    }
+
+    LifecounterFormat format;
+    format_load(app->storage, app->config_file, checkpoint.format_id, &format);
+    game_restore(&table->game, &format, &checkpoint.model);
+    table->turns = checkpoint.turns;
+    uint32_t replayed = journal_replay(&table->journal, tail, app_replay_event, table);
+    journal_resume_finish(&table->journal, game_live(&table->game), &table->turns);
+
+    FURI_LOG_I(TAG, "Resumed game of %lu operations, replayed %lu", table->journal.events, replayed);
+    return true;
+}
+
+typedef struct {
+    LifecounterGame game; // Scratch game the journal is replayed into
+    LifecounterGraph* graph;
+} LifecounterGraphReplay;
+
+static void graph_replay_event(const LifecounterJournalEvent* event, void* context) {
+    LifecounterGraphReplay* replay = context;
+    GameOp op = {.type = event->type, .value = event->value};
+    if(game_apply(&replay->game, &op) && app_graphed(op.type)) {
+        graph_append(replay->graph, game_live(&replay->game)->life);
+    }
+}
+
+/**
+ * Load the saved graph of the table shown and bring it up to date.
+ *
+ * @details    The graph was saved at a checkpoint of the journal, so only the operations after that
+ *             checkpoint are replayed. The saved graph is only used when the checkpoint it was
+ *             saved at is still in the journal with the same game, otherwise the graph is rebuilt
+ *             from the whole journal.
+ */
+static void app_load_graph(LifecounterApp* app) {
+    char path[JOURNAL_PATH_SIZE];
+    LifecounterGraphMark mark;
+    LifecounterJournalCheckpoint checkpoint;
+    LifecounterGraphReplay replay;
+    LifecounterJournal* journal = app_journal(app);
+
+    tables_path(&app->tables, tables_active_index(&app->tables), TABLES_GRAPH_NAME, path, sizeof(path));
+    if(!graph_load(&app->graph, &mark, app->config_file, path) ||
+       !journal_read_checkpoint(journal, mark.checkpoint, &checkpoint) ||
+       checkpoint.events != mark.events || !game_model_equal(&checkpoint.model, &mark.model)) {
+        FURI_LOG_I(TAG, "No saved graph for %s, rebuilding it", journal->path);
+        mark.checkpoint = JOURNAL_FIRST_CHECKPOINT;
+        if(!journal_read_checkpoint(journal, mark.checkpoint, &checkpoint)) {
+            // Nothing to rebuild from, start from what the game is now
+            checkpoint.model = *game_live(app_game(app));
+        }
+        graph_reset(&app->graph, checkpoint.model.life);
+    }
+
+    memset(&replay.game, 0, sizeof(LifecounterGame));
+    game_restore(&replay.game, &app_game(app)->format, &checkpoint.model);
+    replay.graph = &app->graph;
+    uint32_t replayed = journal_replay(
+        journal, mark.checkpoint + JOURNAL_CHECKPOINT_RECORDS, graph_replay_event, &replay);
+    app->graph_stale = false;
+    FURI_LOG_I(TAG, "Loaded graph, replayed %lu", replayed);
+}
+
+#endif
+
+#if LIFECOUNTER_FEATURE_HISTORY
+/**
+ * Queue compaction of the journals of finished games beyond those the settings keep.
+ */
+static void app_compact(LifecounterApp* app) {
+    compact_start(&app->compaction, &app->worker, app->history.count, app->settings.journals_kept);
+}
+#endif
+
+/**
+ * Start a new game with the format selected in the settings.
+ *
+ * @details    Only the selected format profile is read, with a single read from its file.
+ */
+static void app_new_game(LifecounterApp* app) {
+#if LIFECOUNTER_FEATURE_HISTORY
+    // The game being replaced is over, record it before its journal is restarted
+    history_finish_game(&app->history, app_journal(app), game_live(app_game(app)), app_turns(app));
+    app_compact(app);
+#endif
+    LifecounterFormat format;
+    format_load(app->storage, app->config_file, app->settings.format, &format);
+    game_new(app_game(app), &format, game_starting_life(&format, app->settings.default_life));
+    app_start_records(app);
+}
+
+/**
+ * Label of the menu item that switches tables, shows the table on show.
+ */
+static void app_table_label(char* label, size_t size, uint8_t table) {
+    snprintf(label, size, "Next table (%u/%d)", table + 1, TABLES_COUNT);
+}
+
+/**
+ * Show another table.
+ *
+ * @details    All tables are in RAM, so this only changes the active slot and no file is read. The
+ *             main view shows the new table when it is entered next, the graph of the table is
+ *             loaded from its file once the graph is shown.
+ */
+static void app_switch_table(LifecounterApp* app, uint8_t index) {
+    char label[24];
+    app->settings.table = tables_switch(&app->tables, index);
+    settings_changed(app);
+#if LIFECOUNTER_FEATURE_HISTORY
+    app->graph_stale = true;
+#endif
+    app_table_label(label, sizeof(label), app->settings.table);
+    submenu_change_item_label(app->submenu, LifecounterSubmenuIndexTable, label);
 }
 
 /**
@@ -233,23 +709,56 @@ LifecounterModel* read_config(LifecounterModel* model) {
 */
 static void submenu_callback(void* context, uint32_t index) {
     LifecounterApp* app = (LifecounterApp*)context;
+    uint32_t trace_start = trace_begin();
     switch(index) {
     case LifecounterSubmenuIndexConfigure:
+        memstats_set_phase(LifecounterPhaseSettings);
         view_dispatcher_switch_to_view(app->view_dispatcher, LifecounterViewConfigure);
         break;
     case LifecounterSubmenuIndexMain:
         view_dispatcher_switch_to_view(app->view_dispatcher, LifecounterViewMain);
         break;
     case LifecounterSubmenuIndexReset:
-        LifecounterModel* model = view_get_model(app->view_main);
-        model->player_1_life = model->default_life;
-        model->player_2_life = model->default_life;
-        audio_feedback(model, SoundReset);
+        app_new_game(app);
         view_dispatcher_switch_to_view(app->view_dispatcher, LifecounterViewMain);
+        audio_feedback(&app->settings, SoundReset);
+        break;
+    case LifecounterSubmenuIndexTable:
+        app_switch_table(app, tables_active_index(&app->tables) + 1);
+        view_dispatcher_switch_to_view(app->view_dispatcher, LifecounterViewMain);
+        audio_feedback(&app->settings, SoundPlayerChanged);
+        break;
+#if LIFECOUNTER_FEATURE_DIAGNOSTICS
+    case LifecounterSubmenuIndexDiagnostics:
+        view_dispatcher_switch_to_view(app->view_dispatcher, LifecounterViewDiagnostics);
+        break;
+#endif
+    case LifecounterSubmenuIndexTurns:
+        view_dispatcher_switch_to_view(app->view_dispatcher, LifecounterViewTurns);
         break;
+#if LIFECOUNTER_FEATURE_HISTORY
+    case LifecounterSubmenuIndexGraph:
+        view_dispatcher_switch_to_view(app->view_dispatcher, LifecounterViewGraph);
+        break;
+    case LifecounterSubmenuIndexExport:
+        view_dispatcher_switch_to_view(app->view_dispatcher, LifecounterViewExport);
+        break;
+#endif
     default:
         break;
     }
+    trace_end(TracePointSubmenu, trace_start);
+}
+
+/**
+ * Callback for changing the game format, takes effect when the next game starts.
+ */
+static void format_change(VariableItem* item) {
+    LifecounterApp* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    variable_item_set_current_value_text(item, format_name(index));
+    app->settings.format = index;
+    settings_changed(app);
 }
 
 /**
@@ -259,28 +768,23 @@ static void default_life_change(VariableItem* item) {
     LifecounterApp* app = variable_item_get_context(item);
     uint8_t index = variable_item_get_current_value_index(item);
     variable_item_set_current_value_text(item, default_life_names[index]);
-    LifecounterModel* model = view_get_model(app->view_main);
-    model->default_life = default_life_values[index];
+    app->settings.default_life = default_life_values[index];
+    settings_changed(app);
 }
 
 /**
- * Callback for changing the backlight setting.
+ * Callback for changing the backlight power profile.
  */
 static void backlight_change(VariableItem* item) {
     LifecounterApp* app = variable_item_get_context(item);
     uint8_t index = variable_item_get_current_value_index(item);
-    variable_item_set_current_value_text(item, toggle_states_names[index]);
-    app->notifications = furi_record_open(RECORD_NOTIFICATION);
-    if (index == 0) {
-        notification_message(app->notifications, &sequence_display_backlight_enforce_auto);
-    } else {
-        notification_message(app->notifications, &sequence_display_backlight_enforce_on);
-    }
-    furi_record_close(RECORD_NOTIFICATION);
-    LifecounterModel* model = view_get_model(app->view_main);
-    model->backlight_on = index;
+    variable_item_set_current_value_text(item, power_profile_name(index));
+    power_set_profile(&app->power, index);
+    app->settings.backlight = index;
+    settings_changed(app);
 }
 
+#if LIFECOUNTER_FEATURE_AUDIO
 /**
  * Callback for changing the audio setting.
  */
@@ -288,87 +792,867 @@ static void audio_change(VariableItem* item) {
     LifecounterApp* app = variable_item_get_context(item);
     uint8_t index = variable_item_get_current_value_index(item);
     variable_item_set_current_value_text(item, toggle_states_names[index]);
-    LifecounterModel* model = view_get_model(app->view_main);
-    model->sound_on = index;
+    app->settings.sound_on = index;
+    settings_changed(app);
 }
+#endif
 
+#if LIFECOUNTER_FEATURE_HISTORY
 /**
- * Dummy callback for the save button (its value doesn't change).
+ * Callback for changing how many journals of finished games are kept, applied by the next compaction.
  */
-static void value_change_callback_dummy(VariableItem *item) {
-    UNUSED(item);
+static void journals_kept_change(VariableItem* item) {
+    LifecounterApp* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    variable_item_set_current_value_text(item, journals_kept_names[index]);
+    app->settings.journals_kept = journals_kept_values[index];
+    settings_changed(app);
 }
+#endif
 
 /**
- * Callback when item in configuration screen is clicked.
+ * Callback for custom events no view has handled.
  *
  * @param      context  The context - LifecounterApp object.
- * @param      index - The index of the item that was clicked.
+ * @param      event    The event id - LifecounterEventId value.
+ * @return     true if the event was handled.
 */
-static void setting_item_clicked(void* context, uint32_t index) {
+static bool app_custom_event_callback(void* context, uint32_t event) {
     LifecounterApp* app = (LifecounterApp*)context;
-    LifecounterModel* model = view_get_model(app->view_main);
+    switch(event) {
+    case LifecounterEventIdSaveSettings:
+        settings_save(app);
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Render the main screen for a model.
+ *
+ * @param      frame   The frame to render into.
+ * @param      model   The model to render.
+ * @param      layout  Glyph layouts of both life totals, updated when the values have changed.
+*/
+static void view_main_render(
+    LifecounterFrame* frame,
+    const LifecounterModel* model,
+    LifecounterDigitsLayout layout[2]) {
+    digits_layout_update(&layout[0], model->life[0], 32, 32, LIFE_TILE_WIDTH);
+    digits_layout_update(&layout[1], model->life[1], 96, 32, LIFE_TILE_WIDTH);
+    digits_draw(frame, &layout[0]);
+    digits_draw(frame, &layout[1]);
+
+    size_t radius = 4;
+    frame_rframe(frame, 0, 0, 64, 64, radius);
+    frame_rframe(frame, 64, 0, 64, 64, radius);
 
-    /**
-     * Index values in configuration menu:
-     * 0 = default life setting
-     * 1 = backlight setting
-     * 2 = audio setting
-     * 3 = save button
-     */
-    if(index == 3) {
-        audio_feedback(model, SoundLifeChanged);
-        write_config(model);
-        view_dispatcher_switch_to_view(app->view_dispatcher, LifecounterViewSubmenu);
+    size_t triangle_height = 6;
+    size_t triangle_width = 8;
+    if (model->selected_player == 0) {
+        frame_rframe(frame, 4, 4, 56, 56, radius);
+        frame_triangle(frame, 32, 20, triangle_width, triangle_height, CanvasDirectionBottomToTop);
+        frame_triangle(frame, 32, 44, triangle_width, triangle_height, CanvasDirectionTopToBottom);
+    } else {
+        frame_rframe(frame, 68, 4, 56, 56, radius);
+        frame_triangle(frame, 96, 20, triangle_width, triangle_height, CanvasDirectionBottomToTop);
+        frame_triangle(frame, 96, 44, triangle_width, triangle_height, CanvasDirectionTopToBottom);
+    }
+
+    for(size_t i = 0; i < LIFECOUNTER_PLAYERS; i++) {
+        bool commander = model->format_flags & FormatFlagCommanderDamage;
+        // Games journaled before turns were tracked have no turn to show
+        bool turn = model->turn > 0 && model->turn_player == i;
+        if(model->status[i] == PlayerStatusPlaying && !commander && !turn) {
+            continue;
+        }
+        int32_t center = 32 + 64 * i;
+        frame_set_font(frame, FontSecondary);
+        if(model->status[i] != PlayerStatusPlaying) {
+            const char* status = model->status[i] == PlayerStatusWon ? "WIN" : "OUT";
+            frame_str_aligned(frame, center, 6, AlignCenter, AlignTop, status);
+        } else if(turn) {
+            char label[12];
+            snprintf(label, sizeof(label), "Turn %u", model->turn);
+            frame_str_aligned(frame, center, 6, AlignCenter, AlignTop, label);
+        }
+        if(commander) {
+            char damage[8];
+            snprintf(damage, sizeof(damage), "C%d", model->commander_damage[i]);
+            frame_str_aligned(frame, center, 51, AlignCenter, AlignTop, damage);
+        }
     }
 }
 
+#if LIFECOUNTER_FEATURE_SPLASH
+/**
+ * Render the splash screen.
+ */
+static void view_splash_render(LifecounterFrame* frame) {
+    frame_icon(frame, 0, 0, &I_Splash_128x64, SPLASH_ICON_ID);
+}
+#endif
+
+#if LIFECOUNTER_FEATURE_DIAGNOSTICS
+/**
+ * Draw live performance numbers in the lower right corner of the main view.
+ *
+ * @details    Everything shown comes from counters that are kept anyway: the render stats of the
+ *             frame, the redraw event counters and the memory stats sampled by the callbacks. Only
+ *             called while the overlay is on, so it costs nothing otherwise.
+ */
+static void view_main_draw_overlay(Canvas* canvas, LifecounterApp* app) {
+    const LifecounterRenderStats* render = frame_get_stats(LifecounterScreenMain);
+    uint32_t now = furi_get_tick();
+    uint32_t window = now - app->overlay_window_tick;
+    char line[16];
+
+    if(window >= furi_ms_to_ticks(1000)) {
+        app->overlay_redraw_rate = (render->frames - app->overlay_window_frames) * furi_ms_to_ticks(1000) / window;
+        app->overlay_window_tick = now;
+        app->overlay_window_frames = render->frames;
+    }
+
+    canvas_set_color(canvas, ColorWhite);
+    canvas_draw_box(canvas, 70, 28, 58, 36);
+    canvas_set_color(canvas, ColorBlack);
+    canvas_draw_frame(canvas, 70, 28, 58, 36);
+    canvas_set_font(canvas, FontKeyboard);
+
+    snprintf(line, sizeof(line), "f %luus", render->last_us);
+    canvas_draw_str(canvas, 73, 37, line);
+    snprintf(
+        line,
+        sizeof(line),
+        "r %lu/s q%lu",
+        app->overlay_redraw_rate,
+        (uint32_t)(atomic_load(&app->redraws_queued) - atomic_load(&app->redraws_executed)));
+    canvas_draw_str(canvas, 73, 45, line);
+    snprintf(line, sizeof(line), "h %zu", memmgr_get_free_heap());
+    canvas_draw_str(canvas, 73, 53, line);
+    snprintf(line, sizeof(line), "s %zu", memstats_get()->stack_free_min);
+    canvas_draw_str(canvas, 73, 61, line);
+}
+#endif
+
 /**
  * Callback for drawing the main screen.
  *
  * @param      canvas  The canvas to draw on.
- * @param      model   The model - MyModel object.
+ * @param      model   The model - pointer to the LifecounterApp object.
 */
 static void view_main_draw_callback(Canvas* canvas, void* model) {
-    LifecounterModel* my_model = (LifecounterModel*)model;
-    FURI_LOG_T(TAG, "view_main_draw_callback");
+    LifecounterApp* app = *(LifecounterApp**)model;
+    LifecounterFrame frame;
+    LifecounterModel snapshot;
+    uint32_t trace_start = trace_begin();
     canvas_set_font(canvas, FontPrimary);
     //canvas_draw_str_aligned(canvas, 7, 6, AlignLeft, AlignTop, "Player 1");
 
-    FuriString* life1 = furi_string_alloc();
-    FuriString* life2 = furi_string_alloc();
-    furi_string_printf(life1, "%d", my_model->player_1_life);
-    furi_string_printf(life2, "%d", my_model->player_2_life);
-    canvas_set_font(canvas, FontBigNumbers);
-    canvas_draw_str_aligned(canvas, 32, 32, AlignCenter, AlignCenter, furi_string_get_cstr(life1));
-    canvas_draw_str_aligned(canvas, 96, 32, AlignCenter, AlignCenter, furi_string_get_cstr(life2));
+    frame_begin(&frame, canvas);
+#if LIFECOUNTER_FEATURE_DIAGNOSTICS
+    uint32_t shown = remote_frame_begin(&app->remote);
+#endif
+    uint8_t table = tables_active_index(&app->tables);
+    game_read_snapshot(&app->tables.slots[table].game, &snapshot);
+    view_main_render(&frame, &snapshot, app->life_layout);
+    if(table > 0) {
+        // The first table looks like the single game of earlier versions, the top is taken by the turn
+        char tag[4];
+        snprintf(tag, sizeof(tag), "T%u", table + 1);
+        frame_set_font(&frame, FontSecondary);
+        frame_str_aligned(&frame, 8, 51, AlignLeft, AlignTop, tag);
+    }
+    frame_end(&frame, LifecounterScreenMain);
+#if LIFECOUNTER_FEATURE_DIAGNOSTICS
+    if(atomic_load(&app->overlay_on)) {
+        view_main_draw_overlay(canvas, app);
+    }
+    uint32_t latency = remote_frame_end(&app->remote, shown);
+#if LIFECOUNTER_FEATURE_TRACE
+    histogram_record(HistogramDraw, frame_get_stats(LifecounterScreenMain)->last_us);
+    if(latency) {
+        histogram_record_cycles(HistogramInputToFrame, latency);
+    }
+#else
+    UNUSED(latency);
+#endif
+#endif
+    trace_end(TracePointMainDraw, trace_start);
+}
 
-    size_t radius = 4;
-    canvas_draw_rframe(canvas, 0, 0, 64, 64, radius);
-    canvas_draw_rframe(canvas, 64, 0, 64, 64, radius);
+#if LIFECOUNTER_FEATURE_SPLASH
+/**
+ * Draw the splash screen.
+ */
+static void view_splash_draw_callback(Canvas* canvas, void* model) {
+    UNUSED(model);
+    LifecounterFrame frame;
+    frame_begin(&frame, canvas);
+    view_splash_render(&frame);
+    frame_end(&frame, LifecounterScreenSplash);
+}
+#endif
 
-    size_t triangle_height = 6;
-    size_t triangle_width = 8;
-    if (my_model->selected_player == 0) {
-        canvas_draw_rframe(canvas, 4, 4, 56, 56, radius);
-        canvas_draw_triangle(canvas, 32, 20, triangle_width, triangle_height, CanvasDirectionBottomToTop);
-        canvas_draw_triangle(canvas, 32, 44, triangle_width, triangle_height, CanvasDirectionTopToBottom);
+/**
+ * Draw the turn totals of the table shown.
+ *
+ * @details    The totals are only updated while the main view is shown, so they can be read
+ *             directly. The column of the player whose turn it is is marked.
+ * @param      canvas  The canvas to draw on.
+ * @param      model   The model - pointer to the LifecounterApp object.
+ */
+static void view_turns_draw_callback(Canvas* canvas, void* model) {
+    LifecounterApp* app = *(LifecounterApp**)model;
+    LifecounterTable* table = tables_active(&app->tables);
+    const LifecounterTurns* turns = &table->turns;
+    LifecounterModel snapshot;
+    char line[16];
+
+    game_read_snapshot(&table->game, &snapshot);
+    canvas_set_font(canvas, FontSecondary);
+    snprintf(line, sizeof(line), "Turn %u", snapshot.turn);
+    canvas_draw_str(canvas, 0, 9, line);
+    for(size_t p = 0; p < LIFECOUNTER_PLAYERS; p++) {
+        int32_t right = 82 + 44 * p;
+        bool active = snapshot.turn > 0 && snapshot.turn_player == p;
+        snprintf(line, sizeof(line), "%sP%zu", active ? ">" : "", p + 1);
+        canvas_draw_str_aligned(canvas, right, 9, AlignRight, AlignBottom, line);
+        snprintf(line, sizeof(line), "%lu", turns->turn[p].damage);
+        canvas_draw_str_aligned(canvas, right, 20, AlignRight, AlignBottom, line);
+        snprintf(line, sizeof(line), "%lu", turns->turn[p].gained);
+        canvas_draw_str_aligned(canvas, right, 31, AlignRight, AlignBottom, line);
+        snprintf(line, sizeof(line), "%+ld", turns_net(&turns->turn[p]));
+        canvas_draw_str_aligned(canvas, right, 42, AlignRight, AlignBottom, line);
+        snprintf(line, sizeof(line), "%+ld", turns_net(&turns->game[p]));
+        canvas_draw_str_aligned(canvas, right, 53, AlignRight, AlignBottom, line);
+        snprintf(line, sizeof(line), "%lu", turns_worst(turns, p));
+        canvas_draw_str_aligned(canvas, right, 63, AlignRight, AlignBottom, line);
+    }
+    canvas_draw_str(canvas, 0, 20, "Lost");
+    canvas_draw_str(canvas, 0, 31, "Gained");
+    canvas_draw_str(canvas, 0, 42, "Net");
+    canvas_draw_str(canvas, 0, 53, "Game net");
+    canvas_draw_str(canvas, 0, 63, "Worst turn");
+    canvas_draw_line(canvas, 0, 11, 127, 11);
+}
+
+#if LIFECOUNTER_FEATURE_HISTORY
+/**
+ * Draw the life graph, one panel per player.
+ *
+ * @details    Each column is a vertical line from the lowest to the highest life the player had
+ *             during the events covered by the column. Both panels share one scale.
+ * @param      frame  The frame to draw into.
+ * @param      graph  The graph to draw.
+ */
+static void view_graph_render(LifecounterFrame* frame, const LifecounterGraph* graph) {
+    int min, max;
+    graph_range(graph, &min, &max);
+    int span = MAX(max - min, 1);
+    char label[8];
+
+    frame_set_font(frame, FontSecondary);
+    for(size_t p = 0; p < LIFECOUNTER_PLAYERS; p++) {
+        int32_t top = p * GRAPH_PANEL_PITCH;
+        int32_t bottom = top + GRAPH_PANEL_HEIGHT - 1;
+        snprintf(label, sizeof(label), "P%zu", p + 1);
+        frame_str_aligned(frame, 0, top, AlignLeft, AlignTop, label);
+        for(uint16_t i = 0; i < graph->count; i++) {
+            const LifecounterGraphSpan* column = &graph->columns[i][p];
+            frame_line(
+                frame,
+                i,
+                bottom - (column->max - min) * (GRAPH_PANEL_HEIGHT - 1) / span,
+                i,
+                bottom - (column->min - min) * (GRAPH_PANEL_HEIGHT - 1) / span);
+        }
+    }
+    frame_line(frame, 0, GRAPH_PANEL_HEIGHT + 1, 127, GRAPH_PANEL_HEIGHT + 1);
+}
+
+/**
+ * Draw the life graph screen.
+ *
+ * @details    The graph is only appended while the main view is shown, so it can be read directly.
+ * @param      canvas  The canvas to draw on.
+ * @param      model   The model - pointer to the LifecounterApp object.
+ */
+static void view_graph_draw_callback(Canvas* canvas, void* model) {
+    LifecounterApp* app = *(LifecounterApp**)model;
+    LifecounterFrame frame;
+    frame_begin(&frame, canvas);
+    view_graph_render(&frame, &app->graph);
+    frame_end(&frame, LifecounterScreenGraph);
+}
+
+/**
+ * Load the graph of the table shown when it is first shown after a switch or a resume.
+ */
+static void view_graph_enter_callback(void* context) {
+    LifecounterApp* app = (LifecounterApp*)context;
+    if(app->graph_stale) {
+        app_load_graph(app);
+    }
+}
+
+/**
+ * Draw the progress of the history export.
+ */
+static void view_export_draw_callback(Canvas* canvas, void* model) {
+    LifecounterApp* app = *(LifecounterApp**)model;
+    const LifecounterExport* exporter = &app->exporter;
+    unsigned int state = atomic_load(&exporter->state);
+    unsigned int exported = atomic_load(&exporter->exported);
+    char line[32];
+
+    canvas_set_font(canvas, FontPrimary);
+    canvas_draw_str(canvas, 0, 10, "Export history");
+    canvas_set_font(canvas, FontSecondary);
+
+    switch(state) {
+    case ExportStateRunning:
+        snprintf(line, sizeof(line), "Match %u of %lu", exported, exporter->total);
+        canvas_draw_str(canvas, 0, 26, line);
+        canvas_draw_frame(canvas, 0, 32, 128, 8);
+        if(exporter->total > 0) {
+            canvas_draw_box(canvas, 0, 32, 128 * exported / exporter->total, 8);
+        }
+        canvas_draw_str(canvas, 0, 62, "Back to cancel");
+        break;
+    case ExportStateDone:
+        snprintf(line, sizeof(line), "%u matches, %luK", exported, (exporter->bytes + 1023) / 1024);
+        canvas_draw_str(canvas, 0, 26, line);
+        canvas_draw_str(canvas, 0, 38, "Saved to " EXPORT_FILENAME);
+        break;
+    case ExportStateCancelled:
+        canvas_draw_str(canvas, 0, 26, "Cancelled");
+        break;
+    default:
+        canvas_draw_str(canvas, 0, 26, "Failed, is the SD card full?");
+        break;
+    }
+}
+
+/**
+ * Start the export when its screen is shown.
+ */
+static void view_export_enter_callback(void* context) {
+    LifecounterApp* app = (LifecounterApp*)context;
+    export_start(&app->exporter, &app->worker, app->history.count);
+}
+
+/**
+ * Back cancels a running export and stays on the screen until it has stopped.
+ */
+static bool view_export_input_callback(InputEvent* event, void* context) {
+    LifecounterApp* app = (LifecounterApp*)context;
+
+    if(event->type == InputTypeShort && event->key == InputKeyBack &&
+       atomic_load(&app->exporter.state) == ExportStateRunning) {
+        export_cancel(&app->exporter);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Redraw the export screen as the export progresses, called from the worker.
+ */
+static void export_progress_callback(void* context) {
+    LifecounterApp* app = (LifecounterApp*)context;
+    with_view_model(
+        app->view_export, LifecounterApp** _model, { UNUSED(_model); }, true);
+}
+
+#endif
+
+#if LIFECOUNTER_FEATURE_DIAGNOSTICS
+/**
+ * Known good frames. Rendering changes that alter any of these hashes change what is on screen,
+ * update the hashes only after checking the new look on a device.
+ */
+typedef struct {
+    LifecounterModel model;
+    uint32_t hash;
+} LifecounterGoldenFrame;
+
+static const LifecounterGoldenFrame golden_frames[] = {
+    {.model = {.selected_player = 0, .life = {20, 20}}, .hash = 0xc236585a},
+    {.model = {.selected_player = 1, .life = {20, 20}}, .hash = 0x4d28d49a},
+    {.model = {.selected_player = 0, .life = {100, 9999}}, .hash = 0x395fb060},
+    {.model = {.selected_player = 1, .life = {-5, -999}}, .hash = 0x31742f61},
+    {.model =
+         {.selected_player = 0,
+          .format_flags = FormatFlagCommanderDamage,
+          .life = {0, 40},
+          .commander_damage = {21, 0},
+          .status = {PlayerStatusLost, PlayerStatusWon}},
+     .hash = 0x26ecdb22},
+    {.model = {.selected_player = 0, .turn_player = 1, .life = {20, 17}, .turn = 12}, .hash = 0xce156c30},
+};
+#define GOLDEN_SPLASH_HASH 0xdcab4e91
+#define GOLDEN_TOTAL (COUNT_OF(golden_frames) + LIFECOUNTER_FEATURE_SPLASH)
+
+/**
+ * Render the golden frames without a canvas and compare their hashes.
+ *
+ * @return     Number of frames matching, GOLDEN_TOTAL when everything matches.
+ */
+static uint8_t render_check_golden(LifecounterApp* app) {
+    LifecounterFrame frame;
+    uint8_t passed = 0;
+
+    for(size_t i = 0; i < COUNT_OF(golden_frames); i++) {
+        app->golden_layout[0].valid = false;
+        app->golden_layout[1].valid = false;
+
+        frame_begin(&frame, NULL);
+        view_main_render(&frame, &golden_frames[i].model, app->golden_layout);
+        if(frame.hash == golden_frames[i].hash) {
+            passed++;
+        } else {
+            FURI_LOG_E(TAG, "Golden frame %zu mismatch: %08lx", i, frame.hash);
+        }
+    }
+
+#if LIFECOUNTER_FEATURE_SPLASH
+    frame_begin(&frame, NULL);
+    view_splash_render(&frame);
+    if(frame.hash == GOLDEN_SPLASH_HASH) {
+        passed++;
     } else {
-        canvas_draw_rframe(canvas, 68, 4, 56, 56, radius);
-        canvas_draw_triangle(canvas, 96, 20, triangle_width, triangle_height, CanvasDirectionBottomToTop);
-        canvas_draw_triangle(canvas, 96, 44, triangle_width, triangle_height, CanvasDirectionTopToBottom);
+        FURI_LOG_E(TAG, "Golden splash mismatch: %08lx", frame.hash);
     }
+#endif
 
-    furi_string_free(life1);
-    furi_string_free(life2);
+    return passed;
 }
 
 /**
- * Draw the splash screen.
+ * Draw the memory page of the diagnostics screen.
  */
-static void view_splash_draw_callback(Canvas* canvas, void* model) {
-    UNUSED(model);
-    canvas_draw_icon(canvas, 0, 0, &I_Splash_128x64);
+static void diagnostics_draw_memory(Canvas* canvas) {
+    const LifecounterMemStats* stats = memstats_get();
+    char line[32];
+
+    snprintf(
+        line,
+        sizeof(line),
+        "Stack %zu/%u",
+        LIFECOUNTER_STACK_SIZE - stats->stack_free_min,
+        LIFECOUNTER_STACK_SIZE);
+    canvas_draw_str(canvas, 0, 8, line);
+    // Fixed whatever the number of tables in use
+    snprintf(line, sizeof(line), "%dx%zuB", TABLES_COUNT, sizeof(LifecounterTable));
+    canvas_draw_str(canvas, 0, 17, line);
+    snprintf(line, sizeof(line), "Heap %zu", stats->heap_used);
+    canvas_draw_str_aligned(canvas, 127, 1, AlignRight, AlignTop, line);
+    // The session peak is the highest of the phase peaks
+    canvas_draw_str_aligned(canvas, 90, 10, AlignRight, AlignTop, "Peak");
+    canvas_draw_str_aligned(canvas, 127, 10, AlignRight, AlignTop, "Growth");
+    for(size_t i = 0; i < LifecounterPhaseCount; i++) {
+        int32_t y = 26 + i * 9;
+        canvas_draw_str(canvas, 0, y, memstats_phase_name(i));
+        snprintf(line, sizeof(line), "%zu", stats->phases[i].heap_peak);
+        canvas_draw_str_aligned(canvas, 90, y - 7, AlignRight, AlignTop, line);
+        snprintf(line, sizeof(line), "%zu", stats->phases[i].heap_growth);
+        canvas_draw_str_aligned(canvas, 127, y - 7, AlignRight, AlignTop, line);
+    }
+}
+
+/**
+ * Draw the render page of the diagnostics screen.
+ */
+static void diagnostics_draw_render(Canvas* canvas, LifecounterApp* app) {
+    char line[32];
+
+    canvas_draw_str(canvas, 0, 8, "Screen");
+    canvas_draw_str_aligned(canvas, 72, 1, AlignRight, AlignTop, "us");
+    canvas_draw_str_aligned(canvas, 102, 1, AlignRight, AlignTop, "max");
+    canvas_draw_str_aligned(canvas, 127, 1, AlignRight, AlignTop, "prim");
+    for(size_t i = 0; i < LifecounterScreenCount; i++) {
+        const LifecounterRenderStats* stats = frame_get_stats(i);
+        int32_t y = 17 + i * 9;
+        canvas_draw_str(canvas, 0, y, frame_screen_name(i));
+        snprintf(line, sizeof(line), "%lu", stats->last_us);
+        canvas_draw_str_aligned(canvas, 72, y - 7, AlignRight, AlignTop, line);
+        snprintf(line, sizeof(line), "%lu", stats->max_us);
+        canvas_draw_str_aligned(canvas, 102, y - 7, AlignRight, AlignTop, line);
+        snprintf(line, sizeof(line), "%u", stats->primitives);
+        canvas_draw_str_aligned(canvas, 127, y - 7, AlignRight, AlignTop, line);
+    }
+
+    uint8_t golden_total = GOLDEN_TOTAL;
+    snprintf(
+        line,
+        sizeof(line),
+        "Golden %u/%u %s",
+        app->golden_passed,
+        golden_total,
+        app->golden_passed == golden_total ? "ok" : "FAIL");
+    canvas_draw_str(canvas, 0, 44, line);
+    snprintf(line, sizeof(line), "Main %08lx", frame_get_stats(LifecounterScreenMain)->hash);
+    canvas_draw_str(canvas, 0, 53, line);
+}
+
+/**
+ * Draw the events page of the diagnostics screen.
+ */
+static void diagnostics_draw_events(Canvas* canvas, LifecounterApp* app) {
+    char line[32];
+    unsigned int requested = atomic_load_explicit(&app->redraws_requested, memory_order_relaxed);
+    unsigned int queued = atomic_load_explicit(&app->redraws_queued, memory_order_relaxed);
+
+    canvas_draw_str(canvas, 0, 8, "Redraws");
+    snprintf(line, sizeof(line), "Requested %u", requested);
+    canvas_draw_str(canvas, 0, 17, line);
+    snprintf(line, sizeof(line), "Queued %u", queued);
+    canvas_draw_str(canvas, 0, 26, line);
+    snprintf(line, sizeof(line), "Executed %u", atomic_load(&app->redraws_executed));
+    canvas_draw_str(canvas, 0, 35, line);
+    snprintf(line, sizeof(line), "Coalesced %u", requested - queued);
+    canvas_draw_str(canvas, 0, 44, line);
+    snprintf(line, sizeof(line), "Snapshots %lu", app_game(app)->published);
+    canvas_draw_str(canvas, 0, 53, line);
+    snprintf(line, sizeof(line), "Read retries %u", atomic_load(&app_game(app)->read_retries));
+    canvas_draw_str(canvas, 0, 62, line);
+}
+
+/**
+ * Draw the power page of the diagnostics screen.
+ */
+static void diagnostics_draw_power(Canvas* canvas, LifecounterApp* app) {
+    char line[32];
+    uint32_t lit_s = power_backlight_on_ms(&app->power) / 1000;
+
+    canvas_draw_str(canvas, 0, 8, "Power");
+    snprintf(line, sizeof(line), "Profile %s", power_profile_name(app->power.profile));
+    canvas_draw_str(canvas, 0, 17, line);
+    snprintf(line, sizeof(line), "Backlight on %lum %02lus", lit_s / 60, lit_s % 60);
+    canvas_draw_str(canvas, 0, 26, line);
+
+    LifecounterEnergyEstimate estimate;
+    energy_estimate(&estimate, power_backlight_on_ms(&app->power));
+    snprintf(line, sizeof(line), "Wakeups %lu draws %lu", estimate.wakeups, estimate.draws);
+    canvas_draw_str(canvas, 0, 35, line);
+    snprintf(line, sizeof(line), "Speaker %lums SD %luB", estimate.speaker_ms, estimate.sd_bytes);
+    canvas_draw_str(canvas, 0, 44, line);
+    snprintf(
+        line,
+        sizeof(line),
+        "Est. %lu.%02lu mAh/h",
+        estimate.average_ua / 1000,
+        estimate.average_ua % 1000 / 10);
+    canvas_draw_str(canvas, 0, 53, line);
+}
+
+#if LIFECOUNTER_FEATURE_TRACE
+/**
+ * Draw the trace page of the diagnostics screen.
+ */
+static void diagnostics_draw_trace(Canvas* canvas, LifecounterApp* app) {
+    char line[32];
+
+    snprintf(line, sizeof(line), "Trace %lu spans", trace_count());
+    canvas_draw_str(canvas, 0, 8, line);
+    snprintf(line, sizeof(line), "Ring keeps %u", TRACE_RECORDS);
+    canvas_draw_str(canvas, 0, 17, line);
+    switch(atomic_load(&app->trace_dump.state)) {
+    case TraceDumpStateRunning:
+        canvas_draw_str(canvas, 0, 35, "Saving...");
+        break;
+    case TraceDumpStateDone:
+        snprintf(line, sizeof(line), "Saved %zuK", (app->trace_dump.bytes + 1023) / 1024);
+        canvas_draw_str(canvas, 0, 35, line);
+        break;
+    case TraceDumpStateFailed:
+        canvas_draw_str(canvas, 0, 35, "Saving FAILED");
+        break;
+    default:
+        break;
+    }
+    canvas_draw_str(canvas, 0, 62, "OK saves " TRACE_FILENAME);
+}
+
+/**
+ * Draw the stall watchdog page of the diagnostics screen with the latest stalls.
+ */
+static void diagnostics_draw_stalls(Canvas* canvas) {
+    const LifecounterStallLog* log = watchdog_get_log();
+    uint32_t stalls = watchdog_stalls();
+    char line[32];
+
+    snprintf(line, sizeof(line), "Stalls %lu over %ums", stalls, log->budget_ms);
+    canvas_draw_str(canvas, 0, 8, line);
+    snprintf(line, sizeof(line), "LED flash %s", log->flash ? "on" : "off");
+    canvas_draw_str(canvas, 0, 17, line);
+    for(uint32_t i = 0; i < 4 && i < stalls && i < WATCHDOG_LOG_ENTRIES; i++) {
+        const LifecounterStall* stall = &log->entries[(stalls - 1 - i) % WATCHDOG_LOG_ENTRIES];
+        // The RTC runs on local time, so the time of day is the timestamp modulo a day
+        uint32_t time = stall->timestamp % 86400;
+        snprintf(
+            line,
+            sizeof(line),
+            "%02lu:%02lu:%02lu %s %lums",
+            time / 3600,
+            time / 60 % 60,
+            time % 60,
+            trace_point_name(stall->point),
+            stall->duration_us / 1000);
+        canvas_draw_str(canvas, 0, 26 + 9 * i, line);
+    }
+    canvas_draw_str(canvas, 0, 62, "Up/Down budget, OK LED");
+}
+
+/**
+ * Draw the latency page of the diagnostics screen, the histograms of this session.
+ */
+static void diagnostics_draw_latency(Canvas* canvas) {
+    static const char* labels[HistogramCount] = {"Input", "Draw", "Storage"};
+    char line[32];
+
+    canvas_draw_str(canvas, 0, 8, "Latency us p50/p99/max");
+    for(size_t h = 0; h < HistogramCount; h++) {
+        snprintf(
+            line,
+            sizeof(line),
+            "%s %lu/%lu/%lu",
+            labels[h],
+            histogram_percentile(h, 500),
+            histogram_percentile(h, 990),
+            histogram_max(h));
+        canvas_draw_str(canvas, 0, 19 + 9 * h, line);
+    }
+    snprintf(
+        line,
+        sizeof(line),
+        "n %lu %lu %lu",
+        histogram_count(HistogramInputToFrame),
+        histogram_count(HistogramDraw),
+        histogram_count(HistogramStorage));
+    canvas_draw_str(canvas, 0, 50, line);
+    canvas_draw_str(canvas, 0, 62, "Added to " HISTOGRAM_FILENAME " on exit");
+}
+
+/**
+ * Blink the LED when the stall watchdog catches a callback over its budget.
+ */
+static void watchdog_stall_callback(void* context) {
+    LifecounterApp* app = (LifecounterApp*)context;
+    if(app->notifications) {
+        notification_message(app->notifications, &sequence_blink_red_100);
+    }
+}
+
+/**
+ * Switch the stall budget to the next or previous step.
+ */
+static void watchdog_step_budget(int direction) {
+    uint16_t budget = watchdog_get_log()->budget_ms;
+    size_t count = COUNT_OF(stall_budgets_ms);
+    size_t index = 0;
+    while(index < count && stall_budgets_ms[index] != budget) {
+        index++;
+    }
+    index = index == count ? 1 : (index + count + direction) % count;
+    watchdog_set_budget(stall_budgets_ms[index]);
+}
+#endif
+
+#if LIFECOUNTER_FEATURE_HISTORY
+/**
+ * Draw the storage page of the diagnostics screen, the counters are read while the worker updates them.
+ */
+static void diagnostics_draw_storage(Canvas* canvas, LifecounterApp* app) {
+    const LifecounterCompaction* compaction = &app->compaction;
+    char line[32];
+
+    snprintf(
+        line,
+        sizeof(line),
+        "Worker %s steps %u",
+        atomic_load(&app->worker.busy) ? "busy" : "idle",
+        atomic_load(&app->worker.steps));
+    canvas_draw_str(canvas, 0, 8, line);
+    snprintf(line, sizeof(line), "Compacted %lu games", compaction->compacted);
+    canvas_draw_str(canvas, 0, 17, line);
+    snprintf(
+        line,
+        sizeof(line),
+        "Freed %luK curves %luK",
+        compaction->reclaimed_bytes / 1024,
+        compaction->curve_bytes / 1024);
+    canvas_draw_str(canvas, 0, 26, line);
+    if(app->settings.journals_kept) {
+        snprintf(line, sizeof(line), "Keep %d journals", app->settings.journals_kept);
+    } else {
+        snprintf(line, sizeof(line), "Keep all journals");
+    }
+    canvas_draw_str(canvas, 0, 35, line);
+    snprintf(line, sizeof(line), "Next %lu of %lu", compaction->next_id, app->history.count);
+    canvas_draw_str(canvas, 0, 44, line);
+}
+
+/**
+ * Draw the stress page of the diagnostics screen.
+ */
+static void diagnostics_draw_stress(Canvas* canvas, LifecounterApp* app) {
+    static const char* states[] = {"OK to run", "running", "done", "FAILED"};
+    const LifecounterStressResult* result = &app->stress.result;
+    unsigned int state = atomic_load(&app->stress.state);
+    char line[32];
+
+    snprintf(line, sizeof(line), "Stress %s", states[state]);
+    canvas_draw_str(canvas, 0, 8, line);
+    snprintf(line, sizeof(line), "Matches %u/%u", atomic_load(&app->stress.progress), STRESS_MATCHES);
+    canvas_draw_str(canvas, 0, 17, line);
+    if(state == StressStateDone) {
+        snprintf(line, sizeof(line), "Events %lu %lu/s", result->events, result->events_per_s);
+        canvas_draw_str(canvas, 0, 26, line);
+        snprintf(
+            line,
+            sizeof(line),
+            "Jnl %luK hist %luK",
+            result->journal_bytes / 1024,
+            result->history_bytes / 1024);
+        canvas_draw_str(canvas, 0, 35, line);
+        snprintf(line, sizeof(line), "Find %luus rebuild %lums", result->lookup_us, result->rebuild_ms);
+        canvas_draw_str(canvas, 0, 44, line);
+        snprintf(
+            line,
+            sizeof(line),
+            "Resume %lums full %lums",
+            result->resume_us / 1000,
+            result->full_replay_us / 1000);
+        canvas_draw_str(canvas, 0, 53, line);
+    }
+    snprintf(line, sizeof(line), "History %lu matches", app->history.count);
+    canvas_draw_str(canvas, 0, 62, line);
+}
+#endif
+
+#if LIFECOUNTER_FEATURE_HISTORY || LIFECOUNTER_FEATURE_TRACE
+/**
+ * Redraw the diagnostics screen as the stress simulation or the trace dump progresses, called from
+ * the thread running it.
+ */
+static void diagnostics_progress_callback(void* context) {
+    LifecounterApp* app = (LifecounterApp*)context;
+    with_view_model(
+        app->view_diagnostics, LifecounterApp** _model, { UNUSED(_model); }, true);
+}
+#endif
+
+/**
+ * Draw the diagnostics screen.
+ *
+ * @param      canvas  The canvas to draw on.
+ * @param      model   The model - pointer to the LifecounterApp object.
+ */
+static void view_diagnostics_draw_callback(Canvas* canvas, void* model) {
+    LifecounterApp* app = *(LifecounterApp**)model;
+
+    canvas_set_font(canvas, FontSecondary);
+    switch(app->diagnostics_page) {
+    case LifecounterDiagnosticsPageMemory:
+        diagnostics_draw_memory(canvas);
+        break;
+    case LifecounterDiagnosticsPageRender:
+        diagnostics_draw_render(canvas, app);
+        break;
+    case LifecounterDiagnosticsPageEvents:
+        diagnostics_draw_events(canvas, app);
+        break;
+    case LifecounterDiagnosticsPagePower:
+        diagnostics_draw_power(canvas, app);
+        break;
+#if LIFECOUNTER_FEATURE_TRACE
+    case LifecounterDiagnosticsPageTrace:
+        diagnostics_draw_trace(canvas, app);
+        break;
+    case LifecounterDiagnosticsPageStalls:
+        diagnostics_draw_stalls(canvas);
+        break;
+    case LifecounterDiagnosticsPageLatency:
+        diagnostics_draw_latency(canvas);
+        break;
+#endif
+#if LIFECOUNTER_FEATURE_HISTORY
+    case LifecounterDiagnosticsPageStorage:
+        diagnostics_draw_storage(canvas, app);
+        break;
+    case LifecounterDiagnosticsPageStress:
+        diagnostics_draw_stress(canvas, app);
+        break;
+#endif
+    default:
+        break;
+    }
+}
+
+/**
+ * Switch diagnostics pages with left and right, OK starts the stress simulation on its page.
+ */
+static bool view_diagnostics_input_callback(InputEvent* event, void* context) {
+    LifecounterApp* app = (LifecounterApp*)context;
+
+    if(event->type == InputTypeShort) {
+        if(event->key == InputKeyRight) {
+            app->diagnostics_page = (app->diagnostics_page + 1) % LifecounterDiagnosticsPageCount;
+        } else if(event->key == InputKeyLeft) {
+            app->diagnostics_page = (app->diagnostics_page + LifecounterDiagnosticsPageCount - 1) %
+                                    LifecounterDiagnosticsPageCount;
+#if LIFECOUNTER_FEATURE_HISTORY
+        } else if(event->key == InputKeyOk && app->diagnostics_page == LifecounterDiagnosticsPageStress) {
+            stress_start(&app->stress);
+#endif
+#if LIFECOUNTER_FEATURE_TRACE
+        } else if(event->key == InputKeyOk && app->diagnostics_page == LifecounterDiagnosticsPageTrace) {
+            trace_dump_start(&app->trace_dump, &app->worker);
+        } else if(event->key == InputKeyOk && app->diagnostics_page == LifecounterDiagnosticsPageStalls) {
+            watchdog_set_flash(!watchdog_get_log()->flash);
+        } else if(
+            (event->key == InputKeyUp || event->key == InputKeyDown) &&
+            app->diagnostics_page == LifecounterDiagnosticsPageStalls) {
+            watchdog_step_budget(event->key == InputKeyUp ? 1 : -1);
+#endif
+        } else {
+            return false;
+        }
+        with_view_model(
+            app->view_diagnostics, LifecounterApp** _model, { UNUSED(_model); }, true);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Take a fresh sample and check the golden frames when entering the diagnostics screen.
+ */
+static void view_diagnostics_enter_callback(void* context) {
+    LifecounterApp* app = (LifecounterApp*)context;
+    memstats_sample();
+    app->golden_passed = render_check_golden(app);
+}
+#endif
+
+/**
+ * Ask for the main screen to be redrawn.
+ *
+ * @details    Requests collapse into a single pending flag: while a redraw event sits in the
+ *             dispatcher queue no further ones are sent, so a stalled dispatcher thread finds at most
+ *             one redraw waiting instead of a backlog. Safe to call from any thread.
+ * @param      app  The LifecounterApp object.
+*/
+static void view_main_request_redraw(LifecounterApp* app) {
+    atomic_fetch_add_explicit(&app->redraws_requested, 1, memory_order_relaxed);
+    if(!atomic_exchange(&app->redraw_pending, true)) {
+        atomic_fetch_add_explicit(&app->redraws_queued, 1, memory_order_relaxed);
+        view_dispatcher_send_custom_event(app->view_dispatcher, LifecounterEventIdRedrawScreen);
+    }
 }
 
 /**
@@ -379,9 +1663,23 @@ static void view_splash_draw_callback(Canvas* canvas, void* model) {
 */
 static void view_main_timer_callback(void* context) {
     LifecounterApp* app = (LifecounterApp*)context;
-    view_dispatcher_send_custom_event(app->view_dispatcher, LifecounterEventIdRedrawScreen);
+    uint32_t trace_start = trace_begin();
+    energy_count_wakeup();
+    view_main_request_redraw(app);
+    trace_end(TracePointMainTimer, trace_start);
 }
 
+#if LIFECOUNTER_FEATURE_DIAGNOSTICS
+/**
+ * Redraw events sent to the dispatcher and not handled yet, read by the soak of the CLI command.
+ */
+static uint32_t app_redraw_backlog(void* context) {
+    LifecounterApp* app = (LifecounterApp*)context;
+    uint32_t queued = atomic_load(&app->redraws_queued);
+    return queued - atomic_load(&app->redraws_executed);
+}
+#endif
+
 /**
  * Callback when the user goes to the main screen.
  *
@@ -390,8 +1688,10 @@ static void view_main_timer_callback(void* context) {
 static void view_main_enter_callback(void* context) {
     uint32_t period = furi_ms_to_ticks(200);
     LifecounterApp* app = (LifecounterApp*)context;
-    furi_assert(app->timer == NULL);
-    app->timer = furi_timer_alloc(view_main_timer_callback, FuriTimerTypePeriodic, context);
+    memstats_set_phase(LifecounterPhaseMain);
+    // A redraw event still queued when the view was left went to another view, don't wait for it
+    atomic_store(&app->redraw_pending, false);
+    power_set_active(&app->power, true);
     furi_timer_start(app->timer, period);
 }
 
@@ -403,8 +1703,13 @@ static void view_main_enter_callback(void* context) {
 static void view_main_exit_callback(void* context) {
     LifecounterApp* app = (LifecounterApp*)context;
     furi_timer_stop(app->timer);
-    furi_timer_free(app->timer);
-    app->timer = NULL;
+    power_set_active(&app->power, false);
+    // Whatever is shown next isn't playing, it mustn't count against the steady state
+    memstats_set_phase(LifecounterPhaseMenu);
+#if LIFECOUNTER_FEATURE_HISTORY
+    // Leaving the game is a natural pause, keep the journal on the card up to date
+    journal_sync(app_journal(app), game_live(app_game(app)), app_turns(app));
+#endif
 }
 
 /**
@@ -421,8 +1726,16 @@ static bool view_main_custom_event_callback(uint32_t event, void* context) {
         // Redraw screen by passing true to last parameter of with_view_model.
         {
             bool redraw = true;
+            uint32_t trace_start = trace_begin();
+            // Count before clearing so at most one event is ever queued and not yet executed, and
+            // clear before drawing so a request arriving while drawing queues the next redraw
+            atomic_fetch_add(&app->redraws_executed, 1);
+            atomic_store(&app->redraw_pending, false);
+            memstats_sample();
+            power_tick(&app->power);
             with_view_model(
-                app->view_main, LifecounterModel* _model, { UNUSED(_model); }, redraw);
+                app->view_main, LifecounterApp** _model, { UNUSED(_model); }, redraw);
+            trace_end(TracePointMainRedraw, trace_start);
             return true;
         }
     default:
@@ -430,6 +1743,7 @@ static bool view_main_custom_event_callback(uint32_t event, void* context) {
     }
 }
 
+#if LIFECOUNTER_FEATURE_SPLASH
 /**
  * Callback for splash screen input (in order to exit it).
  */
@@ -445,97 +1759,150 @@ static bool view_splash_input_callback(InputEvent* event, void* context) {
 
     return false;
 }
+#endif
 
 /**
- * Callback for main screen input.
+ * Act on an input on the main screen.
  *
- * @details    This function is called when the user presses a button while on the main screen.
+ * @param      app      The app.
  * @param      event    The event - InputEvent object.
- * @param      context  The context - LifecounterApp object.
  * @return     true if the event was handled, false otherwise.
 */
-static bool view_main_input_callback(InputEvent* event, void* context) {
-    LifecounterApp* app = (LifecounterApp*)context;
-    LifecounterModel* my_model = view_get_model(app->view_main);
+static bool view_main_handle_input(LifecounterApp* app, InputEvent* event) {
+    GameOp op;
+    LifecounterSound sound;
 
-    FURI_LOG_T(TAG, "view_main_input_callback");
+#if LIFECOUNTER_FEATURE_DIAGNOSTICS
+    if(event->type == InputTypeShort || event->type == InputTypeLong) {
+        remote_mark_input(&app->remote);
+    }
+#endif
+    memstats_sample();
+    energy_count_wakeup();
+    // Wake a dimmed display, the input that woke it is still applied below
+    power_activity(&app->power);
 
     if(event->type == InputTypeShort) {
         if(event->key == InputKeyUp) {
-            if (my_model->selected_player == 0) {
-                my_model->player_1_life++;
-            } else {
-                my_model->player_2_life++;
-            }
-            audio_feedback(my_model, SoundLifeChanged);
+            op = (GameOp){.type = GameOpAdjustLife, .value = 1};
+            sound = SoundLifeChanged;
         } else if(event->key == InputKeyDown) {
-            if (my_model->selected_player == 0) {
-                my_model->player_1_life--;
-            } else {
-                my_model->player_2_life--;
-            }
-            audio_feedback(my_model, SoundLifeChanged);
+            op = (GameOp){.type = GameOpAdjustLife, .value = -1};
+            sound = SoundLifeChanged;
         } else if(event->key == InputKeyLeft || event->key == InputKeyRight) {
-           if (my_model->selected_player == 0) {
-                my_model->selected_player = 1;
-            } else {
-                my_model->selected_player = 0;
-            }
-            audio_feedback(my_model, SoundPlayerChanged);
+            op = (GameOp){.type = GameOpSelectNext};
+            sound = SoundPlayerChanged;
+        } else {
+            return false;
         }
+    } else if(event->type == InputTypeLong && (event->key == InputKeyUp || event->key == InputKeyDown)) {
+        // Long press adjusts commander damage, ignored by formats that don't track it
+        op = (GameOp){.type = GameOpAdjustCommanderDamage, .value = event->key == InputKeyUp ? 1 : -1};
+        sound = SoundLifeChanged;
+    } else if(event->type == InputTypeLong && (event->key == InputKeyLeft || event->key == InputKeyRight)) {
+        op = (GameOp){.type = GameOpNextTurn};
+        sound = SoundPlayerChanged;
+#if LIFECOUNTER_FEATURE_DIAGNOSTICS
+    } else if(event->type == InputTypeLong && event->key == InputKeyBack) {
+        atomic_store(&app->overlay_on, !atomic_load(&app->overlay_on));
+        with_view_model(
+            app->view_main, LifecounterApp** _model, { UNUSED(_model); }, true);
+        return true;
+#endif
     } else if(event->type == InputTypePress) {
         if(event->key == InputKeyOk) {
             view_dispatcher_switch_to_view(app->view_dispatcher, LifecounterViewSubmenu);
             return true;
         }
+        return false;
+    } else {
+        return false;
+    }
+
+    if(!app_apply(app, &op)) {
+        return false;
     }
+#if LIFECOUNTER_FEATURE_DIAGNOSTICS
+    remote_mark_update(&app->remote);
+#endif
 
+    // Publish the frame before the feedback beep blocks this thread
     with_view_model(
     app->view_main,
-        LifecounterModel* my_model,
+        LifecounterApp** my_app,
         {
-            UNUSED(my_model);
+            UNUSED(my_app);
         },
         true);
+    audio_feedback(&app->settings, sound);
 
     return false;
 }
 
 /**
-* Find the index of a value in an array
+ * Callback for main screen input.
+ *
+ * @details    This function is called when the user presses a button while on the main screen.
+ * @param      event    The event - InputEvent object.
+ * @param      context  The context - LifecounterApp object.
+ * @return     true if the event was handled, false otherwise.
 */
-int find_index( const int a[], int size, int value )
-{
-    int index = 0;
-    while ( index < size && a[index] != value ) ++index;
-    return ( index == size ? -1 : index );
+static bool view_main_input_callback(InputEvent* event, void* context) {
+    uint32_t trace_start = trace_begin();
+    bool handled = view_main_handle_input((LifecounterApp*)context, event);
+    trace_end(TracePointMainInput, trace_start);
+    return handled;
 }
 
 /**
 * Setup and allocate the application resources
 */
 static LifecounterApp* app_alloc() {
+    memstats_init();
+    energy_init();
+    FURI_LOG_T(TAG, "allocate app arena");
     LifecounterApp* app = (LifecounterApp*)malloc(sizeof(LifecounterApp));
+    memset(app, 0, sizeof(LifecounterApp));
 
     Gui* gui = furi_record_open(RECORD_GUI);
 
-    FURI_LOG_T(TAG, "allocate temporary model for settings");
-    LifecounterModel* settings = (LifecounterModel*)malloc(sizeof(LifecounterModel));
-    settings = read_config(settings);
+    app->storage = furi_record_open(RECORD_STORAGE);
+    app->config_file = storage_file_alloc(app->storage);
+#if LIFECOUNTER_FEATURE_TRACE
+    // Watch from the start, the SD card is slowest on the first reads
+    watchdog_init(app->config_file, APP_DATA_PATH(WATCHDOG_FILENAME), watchdog_stall_callback, app);
+#endif
+    read_config(app);
+    LifecounterSettings* settings = &app->settings;
 
     FURI_LOG_T(TAG, "allocate dispatcher");
     app->view_dispatcher = view_dispatcher_alloc();
     view_dispatcher_attach_to_gui(app->view_dispatcher, gui, ViewDispatcherTypeFullscreen);
     view_dispatcher_set_event_callback_context(app->view_dispatcher, app);
+    view_dispatcher_set_custom_event_callback(app->view_dispatcher, app_custom_event_callback);
+    app->settings_timer = furi_timer_alloc(settings_timer_callback, FuriTimerTypeOnce, app);
 
     FURI_LOG_T(TAG, "allocate menu");
     app->submenu = submenu_alloc();
     submenu_add_item(app->submenu, "Return to life view", LifecounterSubmenuIndexMain, submenu_callback, app);
 
-    submenu_add_item(app->submenu, "Reset lifes", LifecounterSubmenuIndexReset, submenu_callback, app);
+    submenu_add_item(app->submenu, "New game", LifecounterSubmenuIndexReset, submenu_callback, app);
+    char table_label[24];
+    app_table_label(table_label, sizeof(table_label), settings->table);
+    submenu_add_item(app->submenu, table_label, LifecounterSubmenuIndexTable, submenu_callback, app);
+
+    submenu_add_item(app->submenu, "Turn totals", LifecounterSubmenuIndexTurns, submenu_callback, app);
+#if LIFECOUNTER_FEATURE_HISTORY
+    submenu_add_item(app->submenu, "Life graph", LifecounterSubmenuIndexGraph, submenu_callback, app);
+    submenu_add_item(app->submenu, "Export history", LifecounterSubmenuIndexExport, submenu_callback, app);
+#endif
 
     submenu_add_item(app->submenu, "Configure settings", LifecounterSubmenuIndexConfigure, submenu_callback, app);
 
+#if LIFECOUNTER_FEATURE_DIAGNOSTICS
+    submenu_add_item(app->submenu, "Diagnostics", LifecounterSubmenuIndexDiagnostics, submenu_callback, app);
+#endif
+
     view_set_previous_callback(submenu_get_view(app->submenu), navigation_exit_callback);
 
     view_dispatcher_add_view(app->view_dispatcher, LifecounterViewSubmenu, submenu_get_view(app->submenu));
@@ -543,27 +1910,38 @@ static LifecounterApp* app_alloc() {
     app->variable_item_list_settings = variable_item_list_alloc();
     variable_item_list_reset(app->variable_item_list_settings);
     VariableItem* item = variable_item_list_add(
+        app->variable_item_list_settings,
+        "Format",
+        FormatIdCount,
+        format_change,
+        app);
+
+    variable_item_set_current_value_index(item, settings->format);
+    variable_item_set_current_value_text(item, format_name(settings->format));
+
+    item = variable_item_list_add(
         app->variable_item_list_settings,
         "Starting life",
         COUNT_OF(default_life_values),
         default_life_change,
         app);
 
-    uint8_t default_life_index = find_index(default_life_values, sizeof(default_life_values), settings->default_life);
+    // read_config() only accepts listed values
+    uint8_t default_life_index = find_index(default_life_values, COUNT_OF(default_life_values), settings->default_life);
     variable_item_set_current_value_index(item, default_life_index);
     variable_item_set_current_value_text(item, default_life_names[default_life_index]);
 
     item = variable_item_list_add(
         app->variable_item_list_settings,
         "Backlight",
-        COUNT_OF(toggle_state_values),
+        PowerProfileCount,
         backlight_change,
         app);
 
-    uint8_t backlight_index = find_index(toggle_state_values, sizeof(toggle_state_values), settings->backlight_on);
-    variable_item_set_current_value_index(item, backlight_index);
-    variable_item_set_current_value_text(item, toggle_states_names[backlight_index]);
+    variable_item_set_current_value_index(item, settings->backlight);
+    variable_item_set_current_value_text(item, power_profile_name(settings->backlight));
 
+#if LIFECOUNTER_FEATURE_AUDIO
     item = variable_item_list_add(
         app->variable_item_list_settings,
         "Audio feedback",
@@ -571,18 +1949,26 @@ static LifecounterApp* app_alloc() {
         audio_change,
         app);
 
-    uint8_t audio_state_index = find_index(toggle_state_values, sizeof(toggle_state_values), settings->sound_on);
+    uint8_t audio_state_index = find_index(toggle_state_values, COUNT_OF(toggle_state_values), settings->sound_on);
     variable_item_set_current_value_index(item, audio_state_index);
     variable_item_set_current_value_text(item, toggle_states_names[audio_state_index]);
+#endif
 
+#if LIFECOUNTER_FEATURE_HISTORY
     item = variable_item_list_add(
         app->variable_item_list_settings,
-        "Save settings",
-        0,
-        value_change_callback_dummy,
+        "Keep journals",
+        COUNT_OF(journals_kept_values),
+        journals_kept_change,
         app);
 
-    variable_item_list_set_enter_callback(app->variable_item_list_settings, setting_item_clicked, app);
+    // read_config() only accepts listed values
+    uint8_t journals_kept_index =
+        find_index(journals_kept_values, COUNT_OF(journals_kept_values), settings->journals_kept);
+    variable_item_set_current_value_index(item, journals_kept_index);
+    variable_item_set_current_value_text(item, journals_kept_names[journals_kept_index]);
+#endif
+
     view_set_previous_callback(variable_item_list_get_view(app->variable_item_list_settings), navigation_submenu_callback);
     view_dispatcher_add_view(app->view_dispatcher, LifecounterViewConfigure, variable_item_list_get_view(app->variable_item_list_settings));
 
@@ -596,16 +1982,52 @@ static LifecounterApp* app_alloc() {
     view_set_context(app->view_main, app);
     view_set_custom_callback(app->view_main, view_main_custom_event_callback);
 
-    view_allocate_model(app->view_main, ViewModelTypeLockFree, sizeof(LifecounterModel));
-    LifecounterModel* model = view_get_model(app->view_main);
-
-    model->default_life = default_life_values[default_life_index];
-    model->player_1_life = model->default_life;
-    model->player_2_life = model->default_life;
-    model->backlight_on = settings->backlight_on;
-    model->sound_on = settings->sound_on;
+    // The view model only points into the arena so the draw callback can reach the app state
+    view_allocate_model(app->view_main, ViewModelTypeLockFree, sizeof(LifecounterApp*));
+    *(LifecounterApp**)view_get_model(app->view_main) = app;
+
+    settings->default_life = default_life_values[default_life_index];
+    tables_init(&app->tables, app->storage, APP_DATA_PATH(""));
+#if LIFECOUNTER_FEATURE_HISTORY
+    history_init(&app->history, app->storage, APP_DATA_PATH(""));
+    compact_init(&app->compaction, app->storage, APP_DATA_PATH(""));
+#endif
+#if LIFECOUNTER_FEATURE_HISTORY || LIFECOUNTER_FEATURE_TRACE
+    worker_init(&app->worker);
+#endif
+    // Every table is set up now, so switching to one later never reads a file
+    LifecounterFormat format;
+    format_load(app->storage, app->config_file, settings->format, &format);
+    for(size_t i = 0; i < TABLES_COUNT; i++) {
+        tables_switch(&app->tables, i);
+#if LIFECOUNTER_FEATURE_HISTORY
+        if(app_resume_game(app, tables_active(&app->tables))) {
+            continue;
+        }
+#endif
+        game_init(app_game(app), &format, game_starting_life(&format, settings->default_life));
+        app_start_records(app);
+    }
+    tables_switch(&app->tables, settings->table);
+#if LIFECOUNTER_FEATURE_HISTORY
+    // Loaded from the files of the table once the graph is shown
+    app->graph_stale = true;
+    app_compact(app);
+#endif
+
+#if LIFECOUNTER_FEATURE_DIAGNOSTICS
+    LifecounterRemoteHooks hooks = {
+        .tick = view_main_timer_callback,
+        .backlog = app_redraw_backlog,
+        .context = app,
+    };
+    remote_init(&app->remote, &app->tables, &hooks);
+#endif
+
+    app->timer = furi_timer_alloc(view_main_timer_callback, FuriTimerTypePeriodic, app);
     view_dispatcher_add_view(app->view_dispatcher, LifecounterViewMain, app->view_main);
 
+#if LIFECOUNTER_FEATURE_SPLASH
     FURI_LOG_T(TAG, "allocate splash screen");
     app->splash_screen = view_alloc();
     view_set_draw_callback(app->splash_screen, view_splash_draw_callback);
@@ -613,18 +2035,77 @@ static LifecounterApp* app_alloc() {
     view_set_previous_callback(app->splash_screen, navigation_main_callback);
     view_set_context(app->splash_screen, app);
     view_dispatcher_add_view(app->view_dispatcher, LifecounterViewSplash, app->splash_screen);
+#endif
+
+#if LIFECOUNTER_FEATURE_DIAGNOSTICS
+    FURI_LOG_T(TAG, "allocate diagnostics screen");
+    app->view_diagnostics = view_alloc();
+    view_set_draw_callback(app->view_diagnostics, view_diagnostics_draw_callback);
+    view_set_input_callback(app->view_diagnostics, view_diagnostics_input_callback);
+    view_set_enter_callback(app->view_diagnostics, view_diagnostics_enter_callback);
+    view_set_previous_callback(app->view_diagnostics, navigation_submenu_callback);
+    view_set_context(app->view_diagnostics, app);
+    view_allocate_model(app->view_diagnostics, ViewModelTypeLockFree, sizeof(LifecounterApp*));
+    *(LifecounterApp**)view_get_model(app->view_diagnostics) = app;
+    view_dispatcher_add_view(app->view_dispatcher, LifecounterViewDiagnostics, app->view_diagnostics);
+#if LIFECOUNTER_FEATURE_HISTORY
+    stress_init(&app->stress, app->storage, diagnostics_progress_callback, app);
+#endif
+#if LIFECOUNTER_FEATURE_TRACE
+    trace_dump_init(
+        &app->trace_dump, app->storage, APP_DATA_PATH(TRACE_FILENAME), diagnostics_progress_callback, app);
+#endif
+#endif
+
+    FURI_LOG_T(TAG, "allocate turns screen");
+    app->view_turns = view_alloc();
+    view_set_draw_callback(app->view_turns, view_turns_draw_callback);
+    view_set_previous_callback(app->view_turns, navigation_submenu_callback);
+    view_set_context(app->view_turns, app);
+    view_allocate_model(app->view_turns, ViewModelTypeLockFree, sizeof(LifecounterApp*));
+    *(LifecounterApp**)view_get_model(app->view_turns) = app;
+    view_dispatcher_add_view(app->view_dispatcher, LifecounterViewTurns, app->view_turns);
+
+#if LIFECOUNTER_FEATURE_HISTORY
+    FURI_LOG_T(TAG, "allocate graph screen");
+    app->view_graph = view_alloc();
+    view_set_draw_callback(app->view_graph, view_graph_draw_callback);
+    view_set_enter_callback(app->view_graph, view_graph_enter_callback);
+    view_set_previous_callback(app->view_graph, navigation_submenu_callback);
+    view_set_context(app->view_graph, app);
+    view_allocate_model(app->view_graph, ViewModelTypeLockFree, sizeof(LifecounterApp*));
+    *(LifecounterApp**)view_get_model(app->view_graph) = app;
+    view_dispatcher_add_view(app->view_dispatcher, LifecounterViewGraph, app->view_graph);
+
+    FURI_LOG_T(TAG, "allocate export screen");
+    app->view_export = view_alloc();
+    view_set_draw_callback(app->view_export, view_export_draw_callback);
+    view_set_enter_callback(app->view_export, view_export_enter_callback);
+    view_set_input_callback(app->view_export, view_export_input_callback);
+    view_set_previous_callback(app->view_export, navigation_submenu_callback);
+    view_set_context(app->view_export, app);
+    view_allocate_model(app->view_export, ViewModelTypeLockFree, sizeof(LifecounterApp*));
+    *(LifecounterApp**)view_get_model(app->view_export) = app;
+    view_dispatcher_add_view(app->view_dispatcher, LifecounterViewExport, app->view_export);
+    export_init(
+        &app->exporter,
+        app->storage,
+        app->history.path,
+        APP_DATA_PATH(EXPORT_FILENAME),
+        export_progress_callback,
+        app);
+#endif
 
     app->notifications = furi_record_open(RECORD_NOTIFICATION);
+    power_init(&app->power, app->notifications, settings->backlight);
 
-    if (settings->backlight_on) {
-        notification_message(app->notifications, &sequence_display_backlight_enforce_on);
-    } else {
-        notification_message(app->notifications, &sequence_display_backlight_enforce_auto);
-    }
-
+#if LIFECOUNTER_FEATURE_SPLASH
     view_dispatcher_switch_to_view(app->view_dispatcher, LifecounterViewSplash);
+#else
+    view_dispatcher_switch_to_view(app->view_dispatcher, LifecounterViewMain);
+#endif
 
-    free(settings);
+    memstats_sample();
 
     return app;
 }
@@ -633,12 +2114,76 @@ static LifecounterApp* app_alloc() {
 * Free the resources
 */
 static void lifecounter_free(LifecounterApp* app) {
-    notification_message(app->notifications, &sequence_display_backlight_enforce_auto);
+    memstats_report();
+    frame_report();
+    FURI_LOG_I(
+        TAG,
+        "redraws requested=%u queued=%u executed=%u",
+        atomic_load(&app->redraws_requested),
+        atomic_load(&app->redraws_queued),
+        atomic_load(&app->redraws_executed));
+
+#if LIFECOUNTER_FEATURE_DIAGNOSTICS
+    // Nothing may be injected or read from the CLI once teardown starts
+    remote_deinit(&app->remote);
+#endif
+#if LIFECOUNTER_FEATURE_TRACE
+    // Stop before the notification record the stall callback uses is closed
+    watchdog_deinit();
+#endif
+    energy_report(power_backlight_on_ms(&app->power));
+    power_deinit(&app->power);
     furi_record_close(RECORD_NOTIFICATION);
 
+    furi_timer_free(app->timer);
+    // A change still waiting for its save is written now
+    furi_timer_stop(app->settings_timer);
+    furi_timer_free(app->settings_timer);
+    settings_save(app);
+#if LIFECOUNTER_FEATURE_HISTORY && LIFECOUNTER_FEATURE_DIAGNOSTICS
+    stress_deinit(&app->stress);
+#endif
+#if LIFECOUNTER_FEATURE_HISTORY || LIFECOUNTER_FEATURE_TRACE
+    // Stop the worker before the state its jobs use goes away
+    worker_deinit(&app->worker);
+#endif
+#if LIFECOUNTER_FEATURE_TRACE
+    trace_dump_deinit(&app->trace_dump);
+#endif
+#if LIFECOUNTER_FEATURE_HISTORY
+    export_deinit(&app->exporter);
+    compact_deinit(&app->compaction);
+    history_deinit(&app->history);
+#endif
+    tables_deinit(&app->tables);
+#if LIFECOUNTER_FEATURE_TRACE
+    // After the journal and worker are done, so their last storage operations are counted
+    histogram_save(app->storage, app->config_file, APP_DATA_PATH(HISTOGRAM_FILENAME));
+#endif
+    storage_file_free(app->config_file);
+    furi_record_close(RECORD_STORAGE);
+
+    FURI_LOG_T(TAG, "remove turns");
+    view_dispatcher_remove_view(app->view_dispatcher, LifecounterViewTurns);
+    view_free(app->view_turns);
+#if LIFECOUNTER_FEATURE_HISTORY
+    FURI_LOG_T(TAG, "remove graph");
+    view_dispatcher_remove_view(app->view_dispatcher, LifecounterViewGraph);
+    view_free(app->view_graph);
+    FURI_LOG_T(TAG, "remove export");
+    view_dispatcher_remove_view(app->view_dispatcher, LifecounterViewExport);
+    view_free(app->view_export);
+#endif
+#if LIFECOUNTER_FEATURE_DIAGNOSTICS
+    FURI_LOG_T(TAG, "remove diagnostics");
+    view_dispatcher_remove_view(app->view_dispatcher, LifecounterViewDiagnostics);
+    view_free(app->view_diagnostics);
+#endif
+#if LIFECOUNTER_FEATURE_SPLASH
     FURI_LOG_T(TAG, "remove splash");
     view_dispatcher_remove_view(app->view_dispatcher, LifecounterViewSplash);
     view_free(app->splash_screen);
+#endif
     FURI_LOG_T(TAG, "remove main");
     view_dispatcher_remove_view(app->view_dispatcher, LifecounterViewMain);
     view_free(app->view_main);
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <furi_hal.h>
+
+/**
+ * Cheap high resolution timestamps based on the Cortex-M4 cycle counter.
+ *
+ * @details    Reading the counter is a single load, use these on hot paths instead of furi_get_tick
+ *             which only has millisecond resolution.
+ */
+static inline uint32_t clock_cycles(void) {
+    return DWT->CYCCNT;
+}
+
+/**
+ * Microseconds elapsed since a clock_cycles timestamp, valid for spans up to about a minute.
+ */
+static inline uint32_t clock_elapsed_us(uint32_t start_cycles) {
+    return (DWT->CYCCNT - start_cycles) / furi_hal_cortex_instructions_per_microsecond();
+}
@@ -0,0 +1,195 @@
+#include "lifecounter_features.h"
+#include "lifecounter_compact.h"
+#include "lifecounter_energy.h"
+#include "lifecounter_fault.h"
+
+#if LIFECOUNTER_FEATURE_HISTORY
+
+#define TAG "Lifecounter"
+
+_Static_assert(sizeof(LifecounterCurve) == 264, "Curve record layout is stored on the SD card");
+
+static void compact_sample(LifecounterCompaction* compaction, const int life[LIFECOUNTER_PLAYERS]) {
+    LifecounterCurve* curve = &compaction->curve;
+    uint16_t column = MIN(compaction->samples / curve->per_column, (uint32_t)CURVE_COLUMNS - 1);
+    LifecounterGraphSpan* spans = curve->spans[column];
+
+    for(size_t p = 0; p < LIFECOUNTER_PLAYERS; p++) {
+        if(column >= curve->columns) {
+            spans[p].min = life[p];
+            spans[p].max = life[p];
+        } else {
+            spans[p].min = MIN(spans[p].min, life[p]);
+            spans[p].max = MAX(spans[p].max, life[p]);
+        }
+    }
+    curve->columns = MAX(curve->columns, column + 1);
+    compaction->samples++;
+}
+
+static void compact_replay_event(const LifecounterJournalEvent* event, void* context) {
+    LifecounterCompaction* compaction = context;
+    GameOp op = {.type = event->type, .value = event->value};
+    game_apply(&compaction->game, &op);
+    compact_sample(compaction, game_live(&compaction->game)->life);
+}
+
+/**
+ * Continue after the last compacted game, finishing its delete if a crash came in between.
+ */
+static void compact_find_start(LifecounterCompaction* compaction) {
+    LifecounterCurve last;
+    compaction->next_id = 0;
+
+    if(storage_file_open(compaction->file, compaction->curves_path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        uint64_t size = storage_file_size(compaction->file);
+        if(size >= sizeof(LifecounterCurve) &&
+           storage_file_seek(compaction->file, size / sizeof(LifecounterCurve) * sizeof(LifecounterCurve) - sizeof(LifecounterCurve), true) &&
+           storage_file_read(compaction->file, &last, sizeof(last)) == sizeof(last)) {
+            compaction->next_id = last.id + 1;
+        }
+    }
+    storage_file_close(compaction->file);
+
+    if(compaction->next_id > 0) {
+        journal_open_archive(&compaction->journal, compaction->next_id - 1);
+        storage_simply_remove(compaction->storage, compaction->journal.path);
+    }
+}
+
+/**
+ * Open the journal of the next game and set up its replay.
+ *
+ * @return     true if the game has a journal to compact.
+ */
+static bool compact_open_game(LifecounterCompaction* compaction) {
+    LifecounterJournalCheckpoint checkpoint;
+    uint32_t tail;
+
+    journal_open_archive(&compaction->journal, compaction->next_id);
+    if(!journal_resume(&compaction->journal, &checkpoint, &tail) ||
+       !journal_read_checkpoint(&compaction->journal, JOURNAL_FIRST_CHECKPOINT, &checkpoint) ||
+       checkpoint.format_id >= FormatIdCount) {
+        return false;
+    }
+
+    LifecounterFormat format;
+    format_load(compaction->storage, compaction->file, checkpoint.format_id, &format);
+    memset(&compaction->game, 0, sizeof(LifecounterGame));
+    game_restore(&compaction->game, &format, &checkpoint.model);
+
+    // One sample for the starting state and one for every operation
+    uint32_t samples = compaction->journal.events + 1;
+    memset(&compaction->curve, 0, sizeof(LifecounterCurve));
+    compaction->curve.id = compaction->next_id;
+    compaction->curve.per_column = MAX((samples + CURVE_COLUMNS - 1) / CURVE_COLUMNS, 1UL);
+    compaction->samples = 0;
+    compact_sample(compaction, checkpoint.model.life);
+
+    compaction->cursor = (LifecounterJournalCursor){.record = JOURNAL_FIRST_CHECKPOINT + JOURNAL_CHECKPOINT_RECORDS};
+    return true;
+}
+
+/**
+ * Store the curve of the replayed game and delete its journal.
+ */
+static void compact_finish_game(LifecounterCompaction* compaction) {
+    bool stored = false;
+    if(storage_file_open(compaction->file, compaction->curves_path, FSAM_WRITE, FSOM_OPEN_APPEND)) {
+        size_t written = storage_file_write(compaction->file, &compaction->curve, sizeof(LifecounterCurve));
+        energy_count_sd_written(written);
+        stored = written == sizeof(LifecounterCurve);
+    }
+    storage_file_close(compaction->file);
+    if(!stored) {
+        // Keep the journal, the game is compacted again on the next pass
+        FURI_LOG_E(TAG, "Failed to store curve of match %lu", compaction->curve.id);
+        return;
+    }
+
+    FileInfo info;
+    uint32_t size = storage_common_stat(compaction->storage, compaction->journal.path, &info) == FSE_OK ? info.size : 0;
+    if(storage_simply_remove(compaction->storage, compaction->journal.path)) {
+        compaction->reclaimed_bytes += size;
+    }
+    compaction->curve_bytes += sizeof(LifecounterCurve);
+    compaction->compacted++;
+}
+
+/**
+ * One step of a compaction pass, run by the worker.
+ */
+static bool compact_step(void* context) {
+    LifecounterCompaction* compaction = context;
+
+    switch(compaction->stage) {
+    case CompactStageStart:
+        compact_find_start(compaction);
+        compaction->stage = CompactStageNext;
+        return true;
+    case CompactStageNext:
+        if(compaction->next_id >= compaction->end_id) {
+            FURI_LOG_I(
+                TAG,
+                "compaction games=%lu reclaimed_bytes=%lu curve_bytes=%lu",
+                compaction->compacted,
+                compaction->reclaimed_bytes,
+                compaction->curve_bytes);
+            atomic_store(&compaction->active, false);
+            return false;
+        }
+        if(compact_open_game(compaction)) {
+            compaction->stage = CompactStageReplay;
+        } else {
+            // Compacted before or never archived
+            compaction->next_id++;
+        }
+        return true;
+    case CompactStageReplay:
+        if(journal_replay_step(
+               &compaction->journal,
+               &compaction->cursor,
+               COMPACT_STEP_RECORDS,
+               compact_replay_event,
+               compaction)) {
+            compact_finish_game(compaction);
+            compaction->next_id++;
+            compaction->stage = CompactStageNext;
+        }
+        return true;
+    default:
+        atomic_store(&compaction->active, false);
+        return false;
+    }
+}
+
+void compact_init(LifecounterCompaction* compaction, Storage* storage, const char* dir) {
+    memset(compaction, 0, sizeof(LifecounterCompaction));
+    compaction->storage = storage;
+    compaction->file = storage_file_alloc(storage);
+    compaction->dir = dir;
+    snprintf(compaction->curves_path, sizeof(compaction->curves_path), "%scurves.bin", dir);
+    journal_init(&compaction->journal, storage, dir, JOURNAL_FILENAME);
+    atomic_init(&compaction->active, false);
+}
+
+void compact_deinit(LifecounterCompaction* compaction) {
+    journal_deinit(&compaction->journal);
+    storage_file_free(compaction->file);
+}
+
+bool compact_start(LifecounterCompaction* compaction, LifecounterWorker* worker, uint32_t matches, uint32_t keep) {
+    if(keep == 0 || matches <= keep || atomic_exchange(&compaction->active, true)) {
+        return false;
+    }
+
+    compaction->end_id = matches - keep;
+    compaction->stage = CompactStageStart;
+    if(!worker_post(worker, compact_step, compaction)) {
+        atomic_store(&compaction->active, false);
+        return false;
+    }
+    return true;
+}
+
+#endif
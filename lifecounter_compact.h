@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <furi.h>
+#include <storage/storage.h>
+#include "lifecounter_graph.h"
+#include "lifecounter_journal.h"
+#include "lifecounter_worker.h"
+
+#define CURVE_COLUMNS 32 // Columns of the life curve kept for a compacted game
+#define CURVE_PATH_SIZE 64
+#define COMPACT_STEP_RECORDS 64 // Journal records replayed per worker step
+
+/**
+ * Decimated life curve of a compacted game, appended to curves.bin in match id order.
+ */
+typedef struct {
+    uint32_t id; // Match id
+    uint16_t columns; // Columns in use
+    uint16_t per_column; // Journal samples covered by a column
+    LifecounterGraphSpan spans[CURVE_COLUMNS][LIFECOUNTER_PLAYERS];
+} LifecounterCurve;
+
+typedef enum {
+    CompactStageStart,
+    CompactStageNext,
+    CompactStageReplay,
+} LifecounterCompactStage;
+
+/**
+ * Folds the raw journals of old games into life curves and deletes them.
+ *
+ * @details    Match summaries are already in the history, so once a game's curve is stored its
+ *             journal under games/ is no longer needed. Games are compacted oldest first, skipping the
+ *             most recent ones the settings keep. Runs as a worker job, each step reads at most
+ *             COMPACT_STEP_RECORDS records. The state is only touched by the worker while active is set.
+ */
+typedef struct {
+    Storage* storage;
+    File* file; // Used for format profiles and curves.bin
+    const char* dir; // Directory of the history, ends with a slash
+    char curves_path[CURVE_PATH_SIZE];
+    LifecounterJournal journal; // Reader of the archived journal being compacted
+    LifecounterGame game; // The game being replayed
+    LifecounterCurve curve; // Curve of the game being replayed
+    LifecounterJournalCursor cursor;
+    uint32_t samples; // Samples taken of the game being replayed
+    uint32_t next_id; // Next match to compact
+    uint32_t end_id; // First match whose journal is kept
+    uint8_t stage; // LifecounterCompactStage
+    atomic_bool active; // Queued or running on the worker
+    uint32_t compacted; // Games compacted since startup
+    uint32_t reclaimed_bytes; // Bytes of journals deleted since startup
+    uint32_t curve_bytes; // Bytes of curves written since startup
+} LifecounterCompaction;
+
+void compact_init(LifecounterCompaction* compaction, Storage* storage, const char* dir);
+
+/**
+ * Release the compaction, the worker must have been stopped.
+ */
+void compact_deinit(LifecounterCompaction* compaction);
+
+/**
+ * Queue a compaction pass unless one is already queued or running.
+ *
+ * @param      compaction  The compaction.
+ * @param      worker      Worker to run on.
+ * @param      matches     Matches in the history.
+ * @param      keep        Most recent journals to keep, 0 keeps all of them.
+ * @return     true if a pass was queued.
+ */
+bool compact_start(LifecounterCompaction* compaction, LifecounterWorker* worker, uint32_t matches, uint32_t keep);
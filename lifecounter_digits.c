@@ -0,0 +1,136 @@
+#include "lifecounter_digits.h"
+#include "lifecounter_icons.h"
+
+/**
+ * One size of the digit sprites. Widths mirror the sprite sizes in the images directory,
+ * see scripts/gen_digits.py.
+ */
+typedef struct {
+    const Icon* digits[10];
+    uint8_t digit_widths[10];
+    const Icon* minus;
+    uint8_t minus_width;
+    uint8_t height;
+    uint8_t spacing;
+} DigitsTier;
+
+static const DigitsTier tiers[] = {
+    {
+        .digits =
+            {&I_LargeDigit0_14x22,
+             &I_LargeDigit1_6x22,
+             &I_LargeDigit2_14x22,
+             &I_LargeDigit3_14x22,
+             &I_LargeDigit4_14x22,
+             &I_LargeDigit5_14x22,
+             &I_LargeDigit6_14x22,
+             &I_LargeDigit7_14x22,
+             &I_LargeDigit8_14x22,
+             &I_LargeDigit9_14x22},
+        .digit_widths = {14, 6, 14, 14, 14, 14, 14, 14, 14, 14},
+        .minus = &I_LargeMinus_9x22,
+        .minus_width = 9,
+        .height = 22,
+        .spacing = 2,
+    },
+    {
+        .digits =
+            {&I_SmallDigit0_10x16,
+             &I_SmallDigit1_4x16,
+             &I_SmallDigit2_10x16,
+             &I_SmallDigit3_10x16,
+             &I_SmallDigit4_10x16,
+             &I_SmallDigit5_10x16,
+             &I_SmallDigit6_10x16,
+             &I_SmallDigit7_10x16,
+             &I_SmallDigit8_10x16,
+             &I_SmallDigit9_10x16},
+        .digit_widths = {10, 4, 10, 10, 10, 10, 10, 10, 10, 10},
+        .minus = &I_SmallMinus_6x16,
+        .minus_width = 6,
+        .height = 16,
+        .spacing = 2,
+    },
+};
+
+/**
+ * Split a value into glyph indexes, most significant first. Index 10 is the minus sign.
+ *
+ * @return     Number of glyphs.
+ */
+static uint8_t digits_split(int value, uint8_t glyphs[DIGITS_MAX_GLYPHS]) {
+    uint8_t reversed[DIGITS_MAX_GLYPHS];
+    uint8_t count = 0;
+    bool negative = value < 0;
+    unsigned int magnitude = negative ? -value : value;
+
+    do {
+        reversed[count++] = magnitude % 10;
+        magnitude /= 10;
+    } while(magnitude > 0 && count < DIGITS_MAX_GLYPHS);
+
+    uint8_t total = 0;
+    if(negative) {
+        glyphs[total++] = 10;
+    }
+    while(count > 0) {
+        glyphs[total++] = reversed[--count];
+    }
+    return total;
+}
+
+void digits_layout_update(
+    LifecounterDigitsLayout* layout,
+    int value,
+    uint8_t center_x,
+    uint8_t center_y,
+    uint8_t max_width) {
+    value = CLAMP(value, DIGITS_VALUE_MAX, DIGITS_VALUE_MIN);
+    if(layout->valid && layout->value == value) {
+        return;
+    }
+
+    uint8_t glyphs[DIGITS_MAX_GLYPHS];
+    uint8_t count = digits_split(value, glyphs);
+
+    // Pick the largest tier the value fits in, the last tier always fits DIGITS_MAX_GLYPHS glyphs
+    const DigitsTier* tier = NULL;
+    uint8_t tier_index = 0;
+    uint8_t width = 0;
+    for(tier_index = 0; tier_index < COUNT_OF(tiers); tier_index++) {
+        tier = &tiers[tier_index];
+        width = tier->spacing * (count - 1);
+        for(uint8_t i = 0; i < count; i++) {
+            width += glyphs[i] == 10 ? tier->minus_width : tier->digit_widths[glyphs[i]];
+        }
+        if(width <= max_width) {
+            break;
+        }
+    }
+    tier_index = MIN(tier_index, COUNT_OF(tiers) - 1);
+
+    uint8_t x = center_x - width / 2;
+    for(uint8_t i = 0; i < count; i++) {
+        uint8_t glyph_width;
+        if(glyphs[i] == 10) {
+            layout->glyphs[i] = tier->minus;
+            glyph_width = tier->minus_width;
+        } else {
+            layout->glyphs[i] = tier->digits[glyphs[i]];
+            glyph_width = tier->digit_widths[glyphs[i]];
+        }
+        layout->ids[i] = tier_index * 16 + glyphs[i];
+        layout->x[i] = x;
+        x += glyph_width + tier->spacing;
+    }
+    layout->y = center_y - tier->height / 2;
+    layout->count = count;
+    layout->value = value;
+    layout->valid = true;
+}
+
+void digits_draw(LifecounterFrame* frame, const LifecounterDigitsLayout* layout) {
+    for(uint8_t i = 0; i < layout->count; i++) {
+        frame_icon(frame, layout->x[i], layout->y, layout->glyphs[i], layout->ids[i]);
+    }
+}
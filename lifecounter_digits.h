@@ -0,0 +1,47 @@
+#pragma once
+
+#include "lifecounter_frame.h"
+
+/**
+ * Range of values the digit renderer can fit in a player tile.
+ */
+#define DIGITS_VALUE_MIN (-999)
+#define DIGITS_VALUE_MAX 9999
+#define DIGITS_MAX_GLYPHS 4
+
+/**
+ * Precomputed placement of the glyphs of one value.
+ *
+ * @details    The layout is only recomputed when the value changes, drawing it is a plain loop of
+ *             icon blits without measuring any text.
+ */
+typedef struct {
+    bool valid;
+    int value;
+    uint8_t count; // Number of glyphs in use
+    const Icon* glyphs[DIGITS_MAX_GLYPHS];
+    uint8_t ids[DIGITS_MAX_GLYPHS]; // Stable glyph ids for frame hashing
+    uint8_t x[DIGITS_MAX_GLYPHS];
+    uint8_t y;
+} LifecounterDigitsLayout;
+
+/**
+ * Update the layout if the value has changed since the last call.
+ *
+ * @param      layout     The layout to update.
+ * @param      value      The value to show, clamped to DIGITS_VALUE_MIN..DIGITS_VALUE_MAX.
+ * @param      center_x   Horizontal center of the area the value is drawn in.
+ * @param      center_y   Vertical center of the area the value is drawn in.
+ * @param      max_width  Width available for the value, picks the largest size tier that fits.
+ */
+void digits_layout_update(
+    LifecounterDigitsLayout* layout,
+    int value,
+    uint8_t center_x,
+    uint8_t center_y,
+    uint8_t max_width);
+
+/**
+ * Draw a value using a layout computed by digits_layout_update.
+ */
+void digits_draw(LifecounterFrame* frame, const LifecounterDigitsLayout* layout);
@@ -0,0 +1,79 @@
+#include "lifecounter_energy.h"
+#include <stdatomic.h>
+
+#define TAG "Lifecounter"
+
+/**
+ * Cost figures. Currents are in mA, so mA * ms gives uAs. Per event costs are given in uAs.
+ */
+#define ENERGY_BASE_MA 6 // MCU mostly sleeping with the display on and backlight off
+#define ENERGY_BACKLIGHT_MA 15
+#define ENERGY_SPEAKER_MA 40
+#define ENERGY_WAKEUP_UAS 2 // ~200 us of CPU at ~10 mA
+#define ENERGY_DRAW_UAS 12 // Rendering plus the display transfer
+#define ENERGY_SD_BYTES_PER_UAS 10 // ~50 mA for ~1 ms per 512 byte sector
+
+static uint32_t session_start;
+static atomic_uint wakeups;
+static atomic_uint draws;
+static atomic_uint speaker_ms;
+static atomic_uint sd_bytes;
+
+void energy_init(void) {
+    session_start = furi_get_tick();
+    atomic_store(&wakeups, 0);
+    atomic_store(&draws, 0);
+    atomic_store(&speaker_ms, 0);
+    atomic_store(&sd_bytes, 0);
+}
+
+void energy_count_wakeup(void) {
+    atomic_fetch_add_explicit(&wakeups, 1, memory_order_relaxed);
+}
+
+void energy_count_draw(void) {
+    atomic_fetch_add_explicit(&draws, 1, memory_order_relaxed);
+}
+
+void energy_count_speaker_ms(uint32_t ms) {
+    atomic_fetch_add_explicit(&speaker_ms, ms, memory_order_relaxed);
+}
+
+void energy_count_sd_written(size_t bytes) {
+    atomic_fetch_add_explicit(&sd_bytes, bytes, memory_order_relaxed);
+}
+
+void energy_estimate(LifecounterEnergyEstimate* estimate, uint32_t backlight_ms) {
+    estimate->session_ms =
+        (uint64_t)(furi_get_tick() - session_start) * 1000 / furi_kernel_get_tick_frequency();
+    estimate->wakeups = atomic_load_explicit(&wakeups, memory_order_relaxed);
+    estimate->draws = atomic_load_explicit(&draws, memory_order_relaxed);
+    estimate->speaker_ms = atomic_load_explicit(&speaker_ms, memory_order_relaxed);
+    estimate->backlight_ms = backlight_ms;
+    estimate->sd_bytes = atomic_load_explicit(&sd_bytes, memory_order_relaxed);
+
+    uint64_t uas = (uint64_t)estimate->session_ms * ENERGY_BASE_MA;
+    uas += (uint64_t)estimate->backlight_ms * ENERGY_BACKLIGHT_MA;
+    uas += (uint64_t)estimate->speaker_ms * ENERGY_SPEAKER_MA;
+    uas += (uint64_t)estimate->wakeups * ENERGY_WAKEUP_UAS;
+    uas += (uint64_t)estimate->draws * ENERGY_DRAW_UAS;
+    uas += estimate->sd_bytes / ENERGY_SD_BYTES_PER_UAS;
+
+    // uAs per ms is mA, scale to uA
+    estimate->average_ua = estimate->session_ms ? uas * 1000 / estimate->session_ms : 0;
+}
+
+void energy_report(uint32_t backlight_ms) {
+    LifecounterEnergyEstimate estimate;
+    energy_estimate(&estimate, backlight_ms);
+    FURI_LOG_I(
+        TAG,
+        "energy session_ms=%lu wakeups=%lu draws=%lu speaker_ms=%lu backlight_ms=%lu sd_bytes=%lu uah_per_hour=%lu",
+        estimate.session_ms,
+        estimate.wakeups,
+        estimate.draws,
+        estimate.speaker_ms,
+        estimate.backlight_ms,
+        estimate.sd_bytes,
+        estimate.average_ua);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <furi.h>
+
+/**
+ * Rough energy model of a game session.
+ *
+ * @details    Every costly activity is counted where it happens and weighed with the cost figures in
+ *             lifecounter_energy.c. The result is an estimate meant for comparing builds and
+ *             settings with each other, not a measurement. Counters may be bumped from any thread.
+ */
+typedef struct {
+    uint32_t session_ms;
+    uint32_t wakeups; // Timer ticks and input events that woke the app
+    uint32_t draws; // Frames drawn
+    uint32_t speaker_ms; // Time the speaker was driven
+    uint32_t backlight_ms; // Time the backlight was fully lit
+    uint32_t sd_bytes; // Bytes written to the SD card
+    uint32_t average_ua; // Estimated average current, equals uAh per hour of play
+} LifecounterEnergyEstimate;
+
+void energy_init(void);
+
+void energy_count_wakeup(void);
+
+void energy_count_draw(void);
+
+void energy_count_speaker_ms(uint32_t ms);
+
+void energy_count_sd_written(size_t bytes);
+
+/**
+ * Estimate the energy use of the session so far.
+ *
+ * @param      estimate      Filled with the counters and the estimate.
+ * @param      backlight_ms  Time the backlight has been fully lit, tracked by the power controller.
+ */
+void energy_estimate(LifecounterEnergyEstimate* estimate, uint32_t backlight_ms);
+
+/**
+ * Log the estimate as an `energy key=value` line.
+ */
+void energy_report(uint32_t backlight_ms);
@@ -0,0 +1,184 @@
+#include "lifecounter_features.h"
+#include "lifecounter_export.h"
+#include "lifecounter_energy.h"
+#include "lifecounter_fault.h"
+
+#if LIFECOUNTER_FEATURE_HISTORY
+
+#define TAG "Lifecounter"
+
+static const char export_header[] = "id,ended,duration_s,format,winner,starting_life,life_p1,life_p2,operations\n";
+
+/**
+ * Write the buffered rows to the card.
+ *
+ * @return     true if everything was written.
+ */
+static bool export_flush(LifecounterExport* exporter) {
+    size_t written = storage_file_write(exporter->output, exporter->buffer, exporter->length);
+    energy_count_sd_written(written);
+    exporter->bytes += written;
+    bool complete = written == exporter->length;
+    exporter->length = 0;
+    return complete;
+}
+
+/**
+ * Append one row to the buffer, flushing it first when the row doesn't fit.
+ */
+static bool export_append_match(LifecounterExport* exporter, const LifecounterMatch* match) {
+    char winner[4] = "";
+    if(match->winner != MATCH_NO_WINNER) {
+        snprintf(winner, sizeof(winner), "P%u", match->winner + 1);
+    }
+
+    for(int attempt = 0; attempt < 2; attempt++) {
+        size_t space = sizeof(exporter->buffer) - exporter->length;
+        int length = snprintf(
+            exporter->buffer + exporter->length,
+            space,
+            "%lu,%lu,%lu,%s,%s,%d,%d,%d,%lu\n",
+            match->id,
+            match->ended,
+            match->duration_s,
+            format_name(match->format < FormatIdCount ? match->format : FormatIdCustom),
+            winner,
+            match->starting_life,
+            match->final_life[0],
+            match->final_life[1],
+            match->events);
+        if(length >= 0 && (size_t)length < space) {
+            exporter->length += length;
+            return true;
+        }
+        // The row was cut short, write out the complete rows before it and format it again
+        if(!export_flush(exporter)) {
+            return false;
+        }
+    }
+    return false;
+}
+
+/**
+ * End the export, removing the partial file unless it completed.
+ */
+static void export_finish(LifecounterExport* exporter, LifecounterExportState state) {
+    if(state == ExportStateDone && exporter->length > 0 && !export_flush(exporter)) {
+        state = ExportStateFailed;
+    }
+    storage_file_close(exporter->output);
+    if(state != ExportStateDone) {
+        storage_simply_remove(exporter->storage, exporter->path);
+    }
+
+    FURI_LOG_I(
+        TAG,
+        "export state=%u matches=%u bytes=%lu ms=%lu",
+        state,
+        atomic_load(&exporter->exported),
+        exporter->bytes,
+        furi_get_tick() - exporter->start_tick);
+    atomic_store(&exporter->state, state);
+}
+
+/**
+ * Read one batch of matches and format them, run by the worker.
+ */
+static bool export_step(void* context) {
+    LifecounterExport* exporter = context;
+    uint32_t exported = atomic_load(&exporter->exported);
+    LifecounterMatch batch[EXPORT_READ_BATCH];
+
+    if(atomic_load(&exporter->cancel)) {
+        export_finish(exporter, ExportStateCancelled);
+    } else if(exported >= exporter->total) {
+        export_finish(exporter, ExportStateDone);
+    } else {
+        size_t want = MIN(exporter->total - exported, (uint32_t)EXPORT_READ_BATCH);
+        size_t read = 0;
+        if(storage_file_open(exporter->source, exporter->history_path, FSAM_READ, FSOM_OPEN_EXISTING) &&
+           storage_file_seek(exporter->source, exported * sizeof(LifecounterMatch), true)) {
+            read = storage_file_read(exporter->source, batch, want * sizeof(LifecounterMatch)) /
+                   sizeof(LifecounterMatch);
+        }
+        storage_file_close(exporter->source);
+
+        bool appended = read == want;
+        for(size_t i = 0; i < read && appended; i++) {
+            appended = export_append_match(exporter, &batch[i]);
+        }
+        if(appended) {
+            atomic_store(&exporter->exported, exported + read);
+        } else {
+            FURI_LOG_E(TAG, "Export failed at match %lu", exported);
+            export_finish(exporter, ExportStateFailed);
+        }
+    }
+
+    if(exporter->callback) {
+        exporter->callback(exporter->context);
+    }
+    return atomic_load(&exporter->state) == ExportStateRunning;
+}
+
+void export_init(
+    LifecounterExport* exporter,
+    Storage* storage,
+    const char* history_path,
+    const char* path,
+    LifecounterExportCallback callback,
+    void* context) {
+    memset(exporter, 0, sizeof(LifecounterExport));
+    exporter->storage = storage;
+    exporter->source = storage_file_alloc(storage);
+    exporter->output = storage_file_alloc(storage);
+    exporter->history_path = history_path;
+    exporter->path = path;
+    exporter->callback = callback;
+    exporter->context = context;
+    atomic_init(&exporter->exported, 0);
+    atomic_init(&exporter->state, ExportStateIdle);
+    atomic_init(&exporter->cancel, false);
+}
+
+void export_deinit(LifecounterExport* exporter) {
+    if(atomic_load(&exporter->state) == ExportStateRunning) {
+        // The worker stopped in the middle of the export
+        export_finish(exporter, ExportStateCancelled);
+    }
+    storage_file_free(exporter->output);
+    storage_file_free(exporter->source);
+}
+
+bool export_start(LifecounterExport* exporter, LifecounterWorker* worker, uint32_t matches) {
+    if(atomic_load(&exporter->state) == ExportStateRunning) {
+        return false;
+    }
+
+    if(!storage_file_open(exporter->output, exporter->path, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        storage_file_close(exporter->output);
+        FURI_LOG_E(TAG, "Failed to open file: %s", exporter->path);
+        atomic_store(&exporter->state, ExportStateFailed);
+        return false;
+    }
+
+    memcpy(exporter->buffer, export_header, sizeof(export_header) - 1);
+    exporter->length = sizeof(export_header) - 1;
+    exporter->total = matches;
+    exporter->bytes = 0;
+    exporter->start_tick = furi_get_tick();
+    atomic_store(&exporter->exported, 0);
+    atomic_store(&exporter->cancel, false);
+    atomic_store(&exporter->state, ExportStateRunning);
+    if(!worker_post(worker, export_step, exporter)) {
+        export_finish(exporter, ExportStateFailed);
+        return false;
+    }
+    return true;
+}
+
+void export_cancel(LifecounterExport* exporter) {
+    atomic_store(&exporter->cancel, true);
+}
+
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <furi.h>
+#include <storage/storage.h>
+#include "lifecounter_stats.h"
+#include "lifecounter_worker.h"
+
+#define EXPORT_BUFFER_SIZE 256 // Output buffer, written to the card whenever the next row doesn't fit
+#define EXPORT_READ_BATCH 8 // Matches read from the history per worker step
+
+typedef enum {
+    ExportStateIdle,
+    ExportStateRunning,
+    ExportStateDone,
+    ExportStateCancelled,
+    ExportStateFailed,
+} LifecounterExportState;
+
+/**
+ * Called from the worker after every step of an export, for example to redraw its progress.
+ */
+typedef void (*LifecounterExportCallback)(void* context);
+
+/**
+ * Writes the match history to a CSV file on the SD card.
+ *
+ * @details    A single streaming pass over history.bin run as a worker job. Each step reads one batch
+ *             of matches and formats them into a fixed output buffer, so the memory used is the same
+ *             for ten matches or ten thousand. The matches in the history when the export starts are
+ *             written, games finished meanwhile are left for the next export. A cancelled or failed
+ *             export removes its partial file.
+ */
+typedef struct {
+    Storage* storage;
+    File* source; // history.bin, opened for each step so appends are never locked out
+    File* output;
+    const char* history_path;
+    const char* path; // CSV file written
+    LifecounterExportCallback callback;
+    void* context;
+    char buffer[EXPORT_BUFFER_SIZE];
+    size_t length; // Bytes in the buffer
+    uint32_t total; // Matches to export
+    uint32_t bytes; // Bytes written to the card
+    uint32_t start_tick;
+    atomic_uint exported; // Matches formatted so far
+    atomic_uint state; // LifecounterExportState
+    atomic_bool cancel;
+} LifecounterExport;
+
+/**
+ * Set up an export.
+ *
+ * @param      exporter      The export.
+ * @param      storage       Storage record.
+ * @param      history_path  History file to read, must outlive the export.
+ * @param      path          CSV file to write, must outlive the export.
+ * @param      callback      Called after every step, may be NULL.
+ * @param      context       Context for the callback.
+ */
+void export_init(
+    LifecounterExport* exporter,
+    Storage* storage,
+    const char* history_path,
+    const char* path,
+    LifecounterExportCallback callback,
+    void* context);
+
+/**
+ * Release the export, the worker must have been stopped.
+ */
+void export_deinit(LifecounterExport* exporter);
+
+/**
+ * Queue an export of the first matches of the history unless one is already running.
+ *
+ * @return     true if the export was queued.
+ */
+bool export_start(LifecounterExport* exporter, LifecounterWorker* worker, uint32_t matches);
+
+/**
+ * Ask a running export to stop, its partial file is removed on the next step.
+ */
+void export_cancel(LifecounterExport* exporter);
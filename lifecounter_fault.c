@@ -0,0 +1,128 @@
+#define LIFECOUNTER_FAULT_IMPL
+#include "lifecounter_fault.h"
+
+#if LIFECOUNTER_FEATURE_FAULTS
+
+#include <stdatomic.h>
+
+#define TAG "Lifecounter"
+
+static atomic_uint fault_latency_ms;
+static atomic_uint fault_stall_every;
+static atomic_uint fault_stall_ms;
+static atomic_uint fault_short_write_every;
+static atomic_uint fault_open_fail_every;
+static atomic_uint fault_seed = FAULT_SEED;
+
+static atomic_uint fault_operations;
+static atomic_uint fault_stalls;
+static atomic_uint fault_short_writes;
+static atomic_uint fault_open_failures;
+
+/**
+ * Mix an operation number with the seed and a salt per fault, so the faults don't line up.
+ */
+static uint32_t fault_hash(uint32_t operation, uint32_t salt) {
+    uint32_t x = operation ^ atomic_load(&fault_seed) ^ salt;
+    x ^= x >> 16;
+    x *= 0x7FEB352DUL;
+    x ^= x >> 15;
+    x *= 0x846CA68BUL;
+    x ^= x >> 16;
+    return x;
+}
+
+static bool fault_roll(uint32_t operation, uint32_t salt, uint32_t every) {
+    return every && fault_hash(operation, salt) % every == 0;
+}
+
+/**
+ * Wait as configured for an operation and return its sequence number.
+ */
+static uint32_t fault_begin(void) {
+    uint32_t operation = atomic_fetch_add(&fault_operations, 1);
+    uint32_t delay_ms = atomic_load(&fault_latency_ms);
+    if(fault_roll(operation, 0x5354, atomic_load(&fault_stall_every))) {
+        atomic_fetch_add(&fault_stalls, 1);
+        delay_ms += atomic_load(&fault_stall_ms);
+    }
+    if(delay_ms) {
+        furi_delay_ms(delay_ms);
+    }
+    return operation;
+}
+
+void fault_configure(const LifecounterFaultConfig* config) {
+    atomic_store(&fault_latency_ms, config->latency_ms);
+    atomic_store(&fault_stall_every, config->stall_every);
+    atomic_store(&fault_stall_ms, config->stall_ms);
+    atomic_store(&fault_short_write_every, config->short_write_every);
+    atomic_store(&fault_open_fail_every, config->open_fail_every);
+    atomic_store(&fault_seed, config->seed);
+    atomic_store(&fault_operations, 0);
+    atomic_store(&fault_stalls, 0);
+    atomic_store(&fault_short_writes, 0);
+    atomic_store(&fault_open_failures, 0);
+    FURI_LOG_W(
+        TAG,
+        "Storage faults latency_ms=%lu stall=1/%lu,%lums short_write=1/%lu open_fail=1/%lu seed=%lu",
+        config->latency_ms,
+        config->stall_every,
+        config->stall_ms,
+        config->short_write_every,
+        config->open_fail_every,
+        config->seed);
+}
+
+void fault_get(LifecounterFaultConfig* config, LifecounterFaultStats* stats) {
+    if(config) {
+        config->latency_ms = atomic_load(&fault_latency_ms);
+        config->stall_every = atomic_load(&fault_stall_every);
+        config->stall_ms = atomic_load(&fault_stall_ms);
+        config->short_write_every = atomic_load(&fault_short_write_every);
+        config->open_fail_every = atomic_load(&fault_open_fail_every);
+        config->seed = atomic_load(&fault_seed);
+    }
+    if(stats) {
+        stats->operations = atomic_load(&fault_operations);
+        stats->stalls = atomic_load(&fault_stalls);
+        stats->short_writes = atomic_load(&fault_short_writes);
+        stats->open_failures = atomic_load(&fault_open_failures);
+    }
+}
+
+void fault_set_short_writes(uint32_t every) {
+    atomic_store(&fault_short_write_every, every);
+}
+
+bool fault_file_open(File* file, const char* path, FS_AccessMode access_mode, FS_OpenMode open_mode) {
+    uint32_t operation = fault_begin();
+    if(fault_roll(operation, 0x4F50, atomic_load(&fault_open_fail_every))) {
+        atomic_fetch_add(&fault_open_failures, 1);
+        FURI_LOG_W(TAG, "Injected open failure: %s", path);
+        return false;
+    }
+    return storage_file_open(file, path, access_mode, open_mode);
+}
+
+size_t fault_file_read(File* file, void* buff, size_t bytes_to_read) {
+    fault_begin();
+    return storage_file_read(file, buff, bytes_to_read);
+}
+
+size_t fault_file_write(File* file, const void* buff, size_t bytes_to_write) {
+    uint32_t operation = fault_begin();
+    if(bytes_to_write > 1 && fault_roll(operation, 0x5357, atomic_load(&fault_short_write_every))) {
+        atomic_fetch_add(&fault_short_writes, 1);
+        FURI_LOG_W(TAG, "Injected short write of %zu bytes", bytes_to_write / 2);
+        return storage_file_write(file, buff, bytes_to_write / 2);
+    }
+    return storage_file_write(file, buff, bytes_to_write);
+}
+
+bool fault_file_seek(File* file, uint32_t offset, bool from_start) {
+    fault_begin();
+    return storage_file_seek(file, offset, from_start);
+}
+
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <furi.h>
+#include <storage/storage.h>
+#include "lifecounter_features.h"
+
+#define FAULT_SEED 0x9E3779B9UL
+
+/**
+ * Faults to inject into the storage calls, every field 0 turns the fault off.
+ */
+typedef struct {
+    uint32_t latency_ms; // Added to every open, read, write and seek
+    uint32_t stall_every; // On average one operation in this many stalls
+    uint32_t stall_ms; // Length of a stall
+    uint32_t short_write_every; // On average one write in this many writes only half of its data
+    uint32_t open_fail_every; // On average one open in this many fails
+    uint32_t seed; // Same seed and operations give the same faults
+} LifecounterFaultConfig;
+
+typedef struct {
+    uint32_t operations;
+    uint32_t stalls;
+    uint32_t short_writes;
+    uint32_t open_failures;
+} LifecounterFaultStats;
+
+#if LIFECOUNTER_FEATURE_FAULTS
+
+/**
+ * Make the SD card slow and unreliable on purpose.
+ *
+ * @details    Storage calls of the app go through fault_file_open() and the others, which wait and
+ *             fail as configured before they call the real function, so the recovery paths can be
+ *             exercised on a device with a good card. Use with the stall watchdog to see which
+ *             callbacks wait on the card. Safe to call from any thread, the faults of an operation
+ *             are picked from its sequence number and the seed.
+ */
+void fault_configure(const LifecounterFaultConfig* config);
+
+void fault_get(LifecounterFaultConfig* config, LifecounterFaultStats* stats);
+
+/**
+ * Change how often writes are cut short, leaving the other faults and the counts alone.
+ */
+void fault_set_short_writes(uint32_t every);
+
+bool fault_file_open(File* file, const char* path, FS_AccessMode access_mode, FS_OpenMode open_mode);
+
+size_t fault_file_read(File* file, void* buff, size_t bytes_to_read);
+
+size_t fault_file_write(File* file, const void* buff, size_t bytes_to_write);
+
+bool fault_file_seek(File* file, uint32_t offset, bool from_start);
+
+// Include this header last, the storage calls of the including file then go through the faults
+#ifndef LIFECOUNTER_FAULT_IMPL
+#define storage_file_open fault_file_open
+#define storage_file_read fault_file_read
+#define storage_file_write fault_file_write
+#define storage_file_seek fault_file_seek
+#endif
+
+#endif
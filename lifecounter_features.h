@@ -0,0 +1,48 @@
+#pragma once
+
+/**
+ * Compile time switches for optional subsystems.
+ *
+ * @details    Every switch defaults to on. The values in application.fam override them, set one to 0
+ *             there to leave the subsystem out of the .fap entirely. scripts/size_report.py builds
+ *             the common variants and reports their section sizes.
+ */
+
+// Sound feedback for inputs and its setting
+#ifndef LIFECOUNTER_FEATURE_AUDIO
+#define LIFECOUNTER_FEATURE_AUDIO 1
+#endif
+
+// Event journal of the current game and the life graph drawn from it
+#ifndef LIFECOUNTER_FEATURE_HISTORY
+#define LIFECOUNTER_FEATURE_HISTORY 1
+#endif
+
+// Splash screen shown at startup, without it the app opens on the life view
+#ifndef LIFECOUNTER_FEATURE_SPLASH
+#define LIFECOUNTER_FEATURE_SPLASH 1
+#endif
+
+// Diagnostics screen with memory, render, event and power pages and the golden frame check
+#ifndef LIFECOUNTER_FEATURE_DIAGNOSTICS
+#define LIFECOUNTER_FEATURE_DIAGNOSTICS 1
+#endif
+
+// Trace points around the callbacks, recorded into a ring and saved from the diagnostics screen
+#ifndef LIFECOUNTER_FEATURE_TRACE
+#define LIFECOUNTER_FEATURE_TRACE 1
+#endif
+
+// Storage fault injection, configured with the lifecounter CLI command and off until then
+#ifndef LIFECOUNTER_FEATURE_FAULTS
+#define LIFECOUNTER_FEATURE_FAULTS 1
+#endif
+
+// The trace can only be saved from the diagnostics screen and the faults are set through the CLI
+// command of the diagnostics, so both go with them
+#if !LIFECOUNTER_FEATURE_DIAGNOSTICS
+#undef LIFECOUNTER_FEATURE_TRACE
+#define LIFECOUNTER_FEATURE_TRACE 0
+#undef LIFECOUNTER_FEATURE_FAULTS
+#define LIFECOUNTER_FEATURE_FAULTS 0
+#endif
@@ -0,0 +1,89 @@
+#include "lifecounter_format.h"
+#include "lifecounter_energy.h"
+#include "lifecounter_fault.h"
+
+#define TAG "Lifecounter"
+#define FORMAT_DIRECTORY APP_DATA_PATH("formats")
+#define FORMAT_PATH_SIZE 64
+
+_Static_assert(sizeof(LifecounterFormat) == 24, "Format record layout is stored on the SD card");
+
+#define FORMAT_DEFAULT(display_name, win_condition, format_flags, life, goal) \
+    {                                                                          \
+        .magic = FORMAT_MAGIC,                                                 \
+        .version = FORMAT_VERSION,                                             \
+        .win = win_condition,                                                  \
+        .flags = format_flags,                                                 \
+        .starting_life = life,                                                 \
+        .target = goal,                                                        \
+        .name = display_name,                                                  \
+    }
+
+static const LifecounterFormat format_defaults[] = {
+    [FormatIdCustom] =
+        FORMAT_DEFAULT("Custom", FormatWinLastStanding, FormatFlagLifeFromSettings, 20, 0),
+    [FormatIdMagic] = FORMAT_DEFAULT("Magic", FormatWinLastStanding, 0, 20, 0),
+    [FormatIdCommander] =
+        FORMAT_DEFAULT("Commander", FormatWinLastStanding, FormatFlagCommanderDamage, 40, 21),
+    [FormatIdFleshAndBlood] =
+        FORMAT_DEFAULT("FaB", FormatWinLastStanding, FormatFlagLifeFromSettings, 20, 0),
+    [FormatIdLorcana] = FORMAT_DEFAULT("Lorcana", FormatWinTarget, FormatFlagNoNegative, 0, 20),
+    [FormatIdSorcery] = FORMAT_DEFAULT("Sorcery", FormatWinLastStanding, 0, 20, 0),
+};
+
+_Static_assert(COUNT_OF(format_defaults) == FormatIdCount, "Every format needs a default");
+
+static void format_path(char* path, LifecounterFormatId id) {
+    snprintf(path, FORMAT_PATH_SIZE, APP_DATA_PATH("formats/%u.lcf"), id);
+}
+
+/**
+ * Write the built-in default of a profile to its file.
+ */
+static void format_write_default(Storage* storage, File* file, LifecounterFormatId id) {
+    char path[FORMAT_PATH_SIZE];
+    format_path(path, id);
+
+    storage_simply_mkdir(storage, FORMAT_DIRECTORY);
+    if(storage_file_open(file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        size_t written = storage_file_write(file, &format_defaults[id], sizeof(LifecounterFormat));
+        energy_count_sd_written(written);
+        if(written != sizeof(LifecounterFormat)) {
+            FURI_LOG_E(TAG, "Failed to write format %s", path);
+        }
+    } else {
+        FURI_LOG_E(TAG, "Failed to create format %s", path);
+    }
+    storage_file_close(file);
+}
+
+bool format_load(Storage* storage, File* file, LifecounterFormatId id, LifecounterFormat* format) {
+    if(id >= FormatIdCount) {
+        id = FormatIdCustom;
+    }
+
+    char path[FORMAT_PATH_SIZE];
+    format_path(path, id);
+
+    bool loaded = false;
+    if(storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        loaded = storage_file_read(file, format, sizeof(LifecounterFormat)) ==
+                     sizeof(LifecounterFormat) &&
+                 format->magic == FORMAT_MAGIC && format->version == FORMAT_VERSION;
+    }
+    storage_file_close(file);
+
+    if(!loaded) {
+        FURI_LOG_W(TAG, "Format %s missing or invalid, restoring default", path);
+        *format = format_defaults[id];
+        format_write_default(storage, file, id);
+    }
+    format->name[FORMAT_NAME_SIZE - 1] = '\0';
+
+    return loaded;
+}
+
+const char* format_name(LifecounterFormatId id) {
+    furi_assert(id < FormatIdCount);
+    return format_defaults[id].name;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <furi.h>
+#include <storage/storage.h>
+
+#define FORMAT_MAGIC 0x5046434CUL // "LCFP" read as little endian
+#define FORMAT_VERSION 1
+#define FORMAT_NAME_SIZE 12
+
+typedef enum {
+    FormatIdCustom, // Starting life from the settings, out at zero life
+    FormatIdMagic,
+    FormatIdCommander,
+    FormatIdFleshAndBlood,
+    FormatIdLorcana,
+    FormatIdSorcery,
+    FormatIdCount,
+} LifecounterFormatId;
+
+typedef enum {
+    FormatWinLastStanding, // Players are out at zero life, the last one left wins
+    FormatWinTarget, // First player to reach the target wins
+} LifecounterFormatWin;
+
+typedef enum {
+    FormatFlagLifeFromSettings = 1 << 0, // Starting life depends on the hero, use the setting
+    FormatFlagCommanderDamage = 1 << 1, // Track commander damage, target damage is lethal
+    FormatFlagNoNegative = 1 << 2, // Counter can't go below zero
+} LifecounterFormatFlag;
+
+/**
+ * A format profile as stored on the SD card, one record per file.
+ */
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t win; // LifecounterFormatWin
+    uint8_t flags; // LifecounterFormatFlag bits
+    uint8_t reserved;
+    int16_t starting_life;
+    int16_t target; // Winning total for FormatWinTarget, lethal commander damage otherwise
+    char name[FORMAT_NAME_SIZE];
+} LifecounterFormat;
+
+/**
+ * Load a format profile with a single read of its file.
+ *
+ * @details    Profiles live in APP_DATA_PATH("formats"). A missing or invalid file is recreated from
+ *             the built-in default, so shops can tune their profiles by replacing the files.
+ * @param      storage  Storage record.
+ * @param      file     File handle to use, must be closed.
+ * @param      id       The profile to load.
+ * @param      format   Filled with the profile.
+ * @return     true if the profile was read from its file.
+ */
+bool format_load(Storage* storage, File* file, LifecounterFormatId id, LifecounterFormat* format);
+
+/**
+ * Name of a profile for menus, available without loading it.
+ */
+const char* format_name(LifecounterFormatId id);
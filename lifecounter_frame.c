@@ -0,0 +1,164 @@
+#include "lifecounter_frame.h"
+#include "lifecounter_clock.h"
+#include "lifecounter_energy.h"
+
+#define TAG "Lifecounter"
+
+#define FNV_OFFSET_BASIS 2166136261UL
+#define FNV_PRIME 16777619UL
+
+typedef enum {
+    FrameOpRframe = 1,
+    FrameOpTriangle,
+    FrameOpIcon,
+    FrameOpFont,
+    FrameOpStr,
+    FrameOpLine,
+} FrameOp;
+
+static const char* screen_names[] = {"Main", "Splash", "Graph"};
+
+static LifecounterRenderStats stats[LifecounterScreenCount];
+
+/**
+ * FNV-1a over the four bytes of a value.
+ */
+static void frame_mix(LifecounterFrame* frame, uint32_t value) {
+    for(size_t i = 0; i < sizeof(value); i++) {
+        frame->hash ^= (value >> (i * 8)) & 0xFF;
+        frame->hash *= FNV_PRIME;
+    }
+}
+
+static void frame_op(LifecounterFrame* frame, FrameOp op) {
+    frame->primitives++;
+    frame_mix(frame, op);
+}
+
+void frame_begin(LifecounterFrame* frame, Canvas* canvas) {
+    frame->canvas = canvas;
+    frame->hash = FNV_OFFSET_BASIS;
+    frame->primitives = 0;
+    frame->start_cycles = clock_cycles();
+}
+
+void frame_end(LifecounterFrame* frame, LifecounterScreen screen) {
+    furi_assert(screen < LifecounterScreenCount);
+    uint32_t elapsed = clock_elapsed_us(frame->start_cycles);
+    LifecounterRenderStats* screen_stats = &stats[screen];
+    screen_stats->frames++;
+    energy_count_draw();
+    screen_stats->last_us = elapsed;
+    screen_stats->total_us += elapsed;
+    if(elapsed > screen_stats->max_us) {
+        screen_stats->max_us = elapsed;
+    }
+    screen_stats->primitives = frame->primitives;
+    screen_stats->hash = frame->hash;
+}
+
+void frame_rframe(LifecounterFrame* frame, int32_t x, int32_t y, size_t width, size_t height, size_t radius) {
+    frame_op(frame, FrameOpRframe);
+    frame_mix(frame, x);
+    frame_mix(frame, y);
+    frame_mix(frame, width);
+    frame_mix(frame, height);
+    frame_mix(frame, radius);
+    if(frame->canvas) {
+        canvas_draw_rframe(frame->canvas, x, y, width, height, radius);
+    }
+}
+
+void frame_line(LifecounterFrame* frame, int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+    frame_op(frame, FrameOpLine);
+    frame_mix(frame, x1);
+    frame_mix(frame, y1);
+    frame_mix(frame, x2);
+    frame_mix(frame, y2);
+    if(frame->canvas) {
+        canvas_draw_line(frame->canvas, x1, y1, x2, y2);
+    }
+}
+
+void frame_triangle(
+    LifecounterFrame* frame,
+    int32_t x,
+    int32_t y,
+    size_t base,
+    size_t height,
+    CanvasDirection direction) {
+    frame_op(frame, FrameOpTriangle);
+    frame_mix(frame, x);
+    frame_mix(frame, y);
+    frame_mix(frame, base);
+    frame_mix(frame, height);
+    frame_mix(frame, direction);
+    if(frame->canvas) {
+        canvas_draw_triangle(frame->canvas, x, y, base, height, direction);
+    }
+}
+
+void frame_icon(LifecounterFrame* frame, int32_t x, int32_t y, const Icon* icon, uint32_t id) {
+    frame_op(frame, FrameOpIcon);
+    frame_mix(frame, x);
+    frame_mix(frame, y);
+    frame_mix(frame, id);
+    if(frame->canvas) {
+        canvas_draw_icon(frame->canvas, x, y, icon);
+    }
+}
+
+void frame_set_font(LifecounterFrame* frame, Font font) {
+    frame_op(frame, FrameOpFont);
+    frame_mix(frame, font);
+    if(frame->canvas) {
+        canvas_set_font(frame->canvas, font);
+    }
+}
+
+void frame_str_aligned(
+    LifecounterFrame* frame,
+    int32_t x,
+    int32_t y,
+    Align horizontal,
+    Align vertical,
+    const char* text) {
+    frame_op(frame, FrameOpStr);
+    frame_mix(frame, x);
+    frame_mix(frame, y);
+    frame_mix(frame, horizontal);
+    frame_mix(frame, vertical);
+    for(const char* c = text; *c; c++) {
+        frame->hash ^= (uint8_t)*c;
+        frame->hash *= FNV_PRIME;
+    }
+    if(frame->canvas) {
+        canvas_draw_str_aligned(frame->canvas, x, y, horizontal, vertical, text);
+    }
+}
+
+const LifecounterRenderStats* frame_get_stats(LifecounterScreen screen) {
+    furi_assert(screen < LifecounterScreenCount);
+    return &stats[screen];
+}
+
+const char* frame_screen_name(LifecounterScreen screen) {
+    furi_assert(screen < LifecounterScreenCount);
+    return screen_names[screen];
+}
+
+void frame_report(void) {
+    for(size_t i = 0; i < LifecounterScreenCount; i++) {
+        const LifecounterRenderStats* screen_stats = &stats[i];
+        uint32_t average = screen_stats->frames ? screen_stats->total_us / screen_stats->frames : 0;
+        FURI_LOG_I(
+            TAG,
+            "render screen=%s frames=%lu avg_us=%lu max_us=%lu primitives=%u hash=%08lx",
+            screen_names[i],
+            screen_stats->frames,
+            average,
+            screen_stats->max_us,
+            screen_stats->primitives,
+            screen_stats->hash);
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <gui/canvas.h>
+
+/**
+ * Screens whose rendering is instrumented.
+ */
+typedef enum {
+    LifecounterScreenMain,
+    LifecounterScreenSplash,
+    LifecounterScreenGraph,
+    LifecounterScreenCount,
+} LifecounterScreen;
+
+/**
+ * Records the drawing primitives of one frame.
+ *
+ * @details    Every primitive and its arguments are folded into a hash, so two frames with the same
+ *             hash look the same. With canvas set to NULL nothing is drawn and only the hash and
+ *             primitive count are produced, which lets frames be checked without a display.
+ */
+typedef struct {
+    Canvas* canvas;
+    uint32_t hash;
+    uint16_t primitives;
+    uint32_t start_cycles;
+} LifecounterFrame;
+
+typedef struct {
+    uint32_t frames; // Number of frames drawn
+    uint32_t last_us; // Render time of the last frame
+    uint32_t max_us; // Slowest frame
+    uint64_t total_us; // Summed render time of all frames
+    uint16_t primitives; // Primitives in the last frame
+    uint32_t hash; // Hash of the last frame
+} LifecounterRenderStats;
+
+void frame_begin(LifecounterFrame* frame, Canvas* canvas);
+
+/**
+ * Finish a frame and account its render time to a screen.
+ */
+void frame_end(LifecounterFrame* frame, LifecounterScreen screen);
+
+void frame_rframe(LifecounterFrame* frame, int32_t x, int32_t y, size_t width, size_t height, size_t radius);
+
+void frame_line(LifecounterFrame* frame, int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+
+void frame_triangle(
+    LifecounterFrame* frame,
+    int32_t x,
+    int32_t y,
+    size_t base,
+    size_t height,
+    CanvasDirection direction);
+
+/**
+ * Draw an icon. Icons are hashed by the caller provided id since their addresses are not stable.
+ */
+void frame_icon(LifecounterFrame* frame, int32_t x, int32_t y, const Icon* icon, uint32_t id);
+
+void frame_set_font(LifecounterFrame* frame, Font font);
+
+void frame_str_aligned(
+    LifecounterFrame* frame,
+    int32_t x,
+    int32_t y,
+    Align horizontal,
+    Align vertical,
+    const char* text);
+
+const LifecounterRenderStats* frame_get_stats(LifecounterScreen screen);
+
+const char* frame_screen_name(LifecounterScreen screen);
+
+/**
+ * Log the render statistics of every screen as `render key=value` lines.
+ */
+void frame_report(void);
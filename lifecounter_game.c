@@ -0,0 +1,160 @@
+#include "lifecounter_game.h"
+#include "lifecounter_digits.h"
+
+static void game_publish(LifecounterGame* game) {
+    unsigned int back = 1 - atomic_load_explicit(&game->front, memory_order_relaxed);
+    LifecounterSnapshot* snapshot = &game->snapshots[back];
+
+    // Seqlock style write, a reader still copying the back buffer notices and retries
+    atomic_fetch_add_explicit(&snapshot->sequence, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    snapshot->model = game->live;
+    atomic_fetch_add_explicit(&snapshot->sequence, 1, memory_order_release);
+
+    atomic_store_explicit(&game->front, back, memory_order_release);
+    game->published++;
+}
+
+/**
+ * Work out who has won or lost according to the rules of the format.
+ */
+static void game_update_status(LifecounterGame* game) {
+    LifecounterModel* live = &game->live;
+    const LifecounterFormat* format = &game->format;
+    size_t playing = 0;
+
+    for(size_t i = 0; i < LIFECOUNTER_PLAYERS; i++) {
+        if(format->win == FormatWinTarget) {
+            live->status[i] = live->life[i] >= format->target ? PlayerStatusWon : PlayerStatusPlaying;
+            continue;
+        }
+        bool out = live->life[i] <= 0;
+        if(format->flags & FormatFlagCommanderDamage) {
+            out |= live->commander_damage[i] >= format->target;
+        }
+        live->status[i] = out ? PlayerStatusLost : PlayerStatusPlaying;
+        playing += !out;
+    }
+
+    if(format->win == FormatWinLastStanding && playing == 1) {
+        for(size_t i = 0; i < LIFECOUNTER_PLAYERS; i++) {
+            if(live->status[i] == PlayerStatusPlaying) {
+                live->status[i] = PlayerStatusWon;
+            }
+        }
+    }
+}
+
+/**
+ * Clamp a counter to what the renderer can show and the format allows.
+ */
+static int game_clamp(const LifecounterGame* game, int value) {
+    int minimum = game->format.flags & FormatFlagNoNegative ? 0 : DIGITS_VALUE_MIN;
+    return CLAMP(value, DIGITS_VALUE_MAX, minimum);
+}
+
+int game_starting_life(const LifecounterFormat* format, int setting) {
+    return format->flags & FormatFlagLifeFromSettings ? setting : format->starting_life;
+}
+
+void game_init(LifecounterGame* game, const LifecounterFormat* format, int starting_life) {
+    memset(game, 0, sizeof(LifecounterGame));
+    game_new(game, format, starting_life);
+}
+
+void game_new(LifecounterGame* game, const LifecounterFormat* format, int starting_life) {
+    game->format = *format;
+    GameOp op = {.type = GameOpReset, .value = starting_life};
+    game_apply(game, &op);
+}
+
+void game_restore(LifecounterGame* game, const LifecounterFormat* format, const LifecounterModel* model) {
+    game->format = *format;
+    game->live = *model;
+    game_publish(game);
+}
+
+bool game_apply(LifecounterGame* game, const GameOp* op) {
+    LifecounterModel* live = &game->live;
+    int* life = &live->life[live->selected_player];
+
+    switch(op->type) {
+    case GameOpAdjustLife: {
+        int adjusted = game_clamp(game, *life + op->value);
+        if(adjusted == *life) {
+            return false;
+        }
+        *life = adjusted;
+        break;
+    }
+    case GameOpAdjustCommanderDamage: {
+        int* damage = &live->commander_damage[live->selected_player];
+        if(!(game->format.flags & FormatFlagCommanderDamage) || *damage + op->value < 0) {
+            return false;
+        }
+        // Commander damage is dealt to life as well
+        *damage += op->value;
+        *life = game_clamp(game, *life - op->value);
+        break;
+    }
+    case GameOpSelectNext:
+        live->selected_player = (live->selected_player + 1) % LIFECOUNTER_PLAYERS;
+        break;
+    case GameOpReset:
+        live->format_flags = game->format.flags;
+        live->turn = 1;
+        live->turn_player = 0;
+        for(size_t i = 0; i < LIFECOUNTER_PLAYERS; i++) {
+            live->life[i] = game_clamp(game, op->value);
+            live->commander_damage[i] = 0;
+        }
+        break;
+    case GameOpNextTurn:
+        if(live->turn == UINT16_MAX) {
+            return false;
+        }
+        live->turn++;
+        live->turn_player = (live->turn_player + 1) % LIFECOUNTER_PLAYERS;
+        break;
+    default:
+        return false;
+    }
+
+    game_update_status(game);
+    game_publish(game);
+    return true;
+}
+
+const LifecounterModel* game_live(const LifecounterGame* game) {
+    return &game->live;
+}
+
+void game_read_snapshot(LifecounterGame* game, LifecounterModel* out) {
+    for(;;) {
+        unsigned int front = atomic_load_explicit(&game->front, memory_order_acquire);
+        LifecounterSnapshot* snapshot = &game->snapshots[front];
+        unsigned int sequence = atomic_load_explicit(&snapshot->sequence, memory_order_acquire);
+        if((sequence & 1) == 0) {
+            *out = snapshot->model;
+            atomic_thread_fence(memory_order_acquire);
+            if(atomic_load_explicit(&snapshot->sequence, memory_order_relaxed) == sequence) {
+                return;
+            }
+        }
+        atomic_fetch_add_explicit(&game->read_retries, 1, memory_order_relaxed);
+    }
+}
+
+bool game_model_equal(const LifecounterModel* a, const LifecounterModel* b) {
+    if(a->selected_player != b->selected_player || a->format_flags != b->format_flags ||
+       a->turn != b->turn || a->turn_player != b->turn_player) {
+        return false;
+    }
+    for(size_t i = 0; i < LIFECOUNTER_PLAYERS; i++) {
+        if(a->life[i] != b->life[i] || a->commander_damage[i] != b->commander_damage[i] ||
+           a->status[i] != b->status[i]) {
+            return false;
+        }
+    }
+    return true;
+}
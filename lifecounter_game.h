@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <furi.h>
+#include "lifecounter_format.h"
+
+#define LIFECOUNTER_PLAYERS 2
+
+typedef enum {
+    PlayerStatusPlaying,
+    PlayerStatusWon,
+    PlayerStatusLost,
+} LifecounterPlayerStatus;
+
+/**
+ * Game state, the unit published to the renderer.
+ */
+typedef struct {
+    uint8_t selected_player;
+    uint8_t format_flags; // LifecounterFormatFlag bits of the format being played
+    uint8_t turn_player; // Player whose turn it is
+    int life[LIFECOUNTER_PLAYERS];
+    int commander_damage[LIFECOUNTER_PLAYERS]; // Commander damage taken
+    uint8_t status[LIFECOUNTER_PLAYERS]; // LifecounterPlayerStatus
+    uint16_t turn; // Turn number from 1, 0 for games journaled before turns were tracked
+} LifecounterModel;
+
+typedef enum {
+    GameOpAdjustLife, // Add value to the life of the selected player
+    GameOpAdjustCommanderDamage, // Add value to the commander damage taken by the selected player
+    GameOpSelectNext, // Select the next player
+    GameOpReset, // Start a new game with value as the starting life
+    GameOpNextTurn, // End the turn and pass it to the next player
+} GameOpType;
+
+/**
+ * One operation on the game state, every change to the game goes through one of these.
+ */
+typedef struct {
+    GameOpType type;
+    int value;
+} GameOp;
+
+typedef struct {
+    atomic_uint sequence; // Odd while the snapshot is being written
+    LifecounterModel model;
+} LifecounterSnapshot;
+
+/**
+ * Game state owned by a single logic context.
+ *
+ * @details    Only the logic context (the view dispatcher thread) applies operations. After each
+ *             operation the complete state is published into the back buffer of a double buffer
+ *             and the buffers are flipped, so readers on other threads see either the state before
+ *             or after an operation, never a half-applied one, without taking a lock.
+ */
+typedef struct {
+    LifecounterFormat format; // Rules of the game being played
+    LifecounterModel live; // Working copy, only touched by the logic context
+    LifecounterSnapshot snapshots[2];
+    atomic_uint front; // Index of the most recently published snapshot
+    uint32_t published; // Number of snapshots published
+    atomic_uint read_retries; // Snapshot reads that raced with a publish and were retried, by any thread
+} LifecounterGame;
+
+/**
+ * Set up a new game and publish its first snapshot.
+ *
+ * @param      game           The game.
+ * @param      format         Rules to play by.
+ * @param      starting_life  Starting life for formats that take it from the settings.
+ */
+void game_init(LifecounterGame* game, const LifecounterFormat* format, int starting_life);
+
+/**
+ * Start a new game with the given rules, publishing it like any other operation.
+ */
+void game_new(LifecounterGame* game, const LifecounterFormat* format, int starting_life);
+
+/**
+ * Continue a game from a saved state, publishing it like any other operation.
+ */
+void game_restore(LifecounterGame* game, const LifecounterFormat* format, const LifecounterModel* model);
+
+/**
+ * Starting life of a format, taking formats with hero specific life into account.
+ */
+int game_starting_life(const LifecounterFormat* format, int setting);
+
+/**
+ * Apply an operation and publish the resulting state. Call only from the logic context.
+ *
+ * @return     true if the state changed.
+ */
+bool game_apply(LifecounterGame* game, const GameOp* op);
+
+/**
+ * State as seen by the logic context.
+ */
+const LifecounterModel* game_live(const LifecounterGame* game);
+
+/**
+ * Copy the latest published state, safe to call from any thread.
+ */
+void game_read_snapshot(LifecounterGame* game, LifecounterModel* out);
+
+/**
+ * Compare two game states field by field, the padding of the model is not defined.
+ */
+bool game_model_equal(const LifecounterModel* a, const LifecounterModel* b);
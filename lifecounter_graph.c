@@ -0,0 +1,109 @@
+#include "lifecounter_features.h"
+#include "lifecounter_graph.h"
+#include "lifecounter_energy.h"
+#include "lifecounter_fault.h"
+
+#if LIFECOUNTER_FEATURE_HISTORY
+
+#define TAG "Lifecounter"
+
+_Static_assert(GRAPH_COLUMNS % 2 == 0, "Columns are merged in pairs");
+_Static_assert(sizeof(LifecounterGraphHeader) == 36, "Graph file layout is stored on the SD card");
+_Static_assert(sizeof(LifecounterGraph) == 1036, "Graph file layout is stored on the SD card");
+
+/**
+ * Merge pairs of full columns, halving the number of columns in use.
+ */
+static void graph_halve(LifecounterGraph* graph) {
+    for(uint16_t i = 0; i < GRAPH_COLUMNS / 2; i++) {
+        for(size_t p = 0; p < LIFECOUNTER_PLAYERS; p++) {
+            LifecounterGraphSpan left = graph->columns[i * 2][p];
+            LifecounterGraphSpan right = graph->columns[i * 2 + 1][p];
+            graph->columns[i][p].min = MIN(left.min, right.min);
+            graph->columns[i][p].max = MAX(left.max, right.max);
+        }
+    }
+
+    graph->count = GRAPH_COLUMNS / 2;
+    graph->per_column *= 2;
+}
+
+void graph_reset(LifecounterGraph* graph, const int life[LIFECOUNTER_PLAYERS]) {
+    graph->count = 0;
+    graph->per_column = 1;
+    graph->filled = 0;
+    graph->events = 0;
+    graph_append(graph, life);
+}
+
+void graph_append(LifecounterGraph* graph, const int life[LIFECOUNTER_PLAYERS]) {
+    graph->events++;
+
+    if(graph->count > 0 && graph->filled < graph->per_column) {
+        LifecounterGraphSpan* spans = graph->columns[graph->count - 1];
+        for(size_t p = 0; p < LIFECOUNTER_PLAYERS; p++) {
+            spans[p].min = MIN(spans[p].min, life[p]);
+            spans[p].max = MAX(spans[p].max, life[p]);
+        }
+        graph->filled++;
+        return;
+    }
+
+    if(graph->count == GRAPH_COLUMNS) {
+        graph_halve(graph);
+    }
+
+    LifecounterGraphSpan* spans = graph->columns[graph->count++];
+    for(size_t p = 0; p < LIFECOUNTER_PLAYERS; p++) {
+        spans[p].min = life[p];
+        spans[p].max = life[p];
+    }
+    graph->filled = 1;
+}
+
+void graph_range(const LifecounterGraph* graph, int* min, int* max) {
+    *min = INT16_MAX;
+    *max = INT16_MIN;
+    for(uint16_t i = 0; i < graph->count; i++) {
+        for(size_t p = 0; p < LIFECOUNTER_PLAYERS; p++) {
+            *min = MIN(*min, graph->columns[i][p].min);
+            *max = MAX(*max, graph->columns[i][p].max);
+        }
+    }
+}
+
+bool graph_save(const LifecounterGraph* graph, const LifecounterGraphMark* mark, File* file, const char* path) {
+    LifecounterGraphHeader header = {.magic = GRAPH_MAGIC, .mark = *mark};
+    size_t written = 0;
+
+    if(storage_file_open(file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        written = storage_file_write(file, &header, sizeof(header));
+        written += storage_file_write(file, graph, sizeof(LifecounterGraph));
+        energy_count_sd_written(written);
+    }
+    storage_file_close(file);
+    if(written != sizeof(header) + sizeof(LifecounterGraph)) {
+        FURI_LOG_E(TAG, "Failed to save %s", path);
+        return false;
+    }
+    return true;
+}
+
+bool graph_load(LifecounterGraph* graph, LifecounterGraphMark* mark, File* file, const char* path) {
+    LifecounterGraphHeader header;
+    bool loaded = false;
+
+    if(storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        loaded = storage_file_read(file, &header, sizeof(header)) == sizeof(header) &&
+                 header.magic == GRAPH_MAGIC &&
+                 storage_file_read(file, graph, sizeof(LifecounterGraph)) == sizeof(LifecounterGraph) &&
+                 graph->count <= GRAPH_COLUMNS;
+    }
+    storage_file_close(file);
+    if(loaded) {
+        *mark = header.mark;
+    }
+    return loaded;
+}
+
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <furi.h>
+#include <storage/storage.h>
+#include "lifecounter_game.h"
+
+#define GRAPH_COLUMNS 128 // One column per pixel of the screen
+#define GRAPH_MAGIC 0x4747434CUL // "LCGG" read as little endian
+
+typedef struct {
+    int16_t min;
+    int16_t max;
+} LifecounterGraphSpan;
+
+/**
+ * Life totals over the game, decimated to the screen width as events are appended.
+ *
+ * @details    Each column holds the min and max of every player over a run of events. When all
+ *             columns are used, neighbouring columns are merged and each column covers twice as many
+ *             events, so appending is amortized O(1) and drawing is O(GRAPH_COLUMNS) no matter how
+ *             long the game is. Updated by the dispatcher thread while the main view is shown and
+ *             only drawn while the graph view is shown.
+ */
+typedef struct {
+    LifecounterGraphSpan columns[GRAPH_COLUMNS][LIFECOUNTER_PLAYERS];
+    uint16_t count; // Columns in use
+    uint16_t per_column; // Events covered by a full column
+    uint16_t filled; // Events in the last column
+    uint32_t events; // Events appended
+} LifecounterGraph;
+
+/**
+ * Journal position a saved graph covers, so it can be continued from there.
+ */
+typedef struct {
+    uint32_t checkpoint; // Journal record of the checkpoint the graph was saved at
+    uint32_t events; // Operations before the checkpoint
+    LifecounterModel model; // Game state at the checkpoint
+} LifecounterGraphMark;
+
+/**
+ * Header of a saved graph, followed by the LifecounterGraph.
+ */
+typedef struct {
+    uint32_t magic;
+    LifecounterGraphMark mark;
+} LifecounterGraphHeader;
+
+/**
+ * Start a graph for a new game.
+ */
+void graph_reset(LifecounterGraph* graph, const int life[LIFECOUNTER_PLAYERS]);
+
+/**
+ * Add the life totals after an event.
+ */
+void graph_append(LifecounterGraph* graph, const int life[LIFECOUNTER_PLAYERS]);
+
+/**
+ * Lowest and highest life of all players in the graph.
+ */
+void graph_range(const LifecounterGraph* graph, int* min, int* max);
+
+/**
+ * Save the graph and the journal position it covers, replacing the file.
+ *
+ * @return     true if everything was written.
+ */
+bool graph_save(const LifecounterGraph* graph, const LifecounterGraphMark* mark, File* file, const char* path);
+
+/**
+ * Load a saved graph.
+ *
+ * @details    The graph is left undefined when the file can't be read, reset it in that case.
+ * @return     true if a graph was loaded.
+ */
+bool graph_load(LifecounterGraph* graph, LifecounterGraphMark* mark, File* file, const char* path);
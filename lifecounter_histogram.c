@@ -0,0 +1,180 @@
+#include "lifecounter_histogram.h"
+#include "lifecounter_energy.h"
+#include <furi_hal.h>
+
+#if LIFECOUNTER_FEATURE_TRACE
+
+#define TAG "Lifecounter"
+#define HISTOGRAM_CHUNK 16 // Counts merged per read and write
+
+typedef struct {
+    atomic_uint counts[HISTOGRAM_BUCKETS];
+    atomic_uint total;
+    atomic_uint max_us;
+} LifecounterHistogram;
+
+static const char* histogram_names[HistogramCount] = {
+    [HistogramInputToFrame] = "input_to_frame",
+    [HistogramDraw] = "draw",
+    [HistogramStorage] = "storage",
+};
+
+static LifecounterHistogram histograms[HistogramCount];
+
+static uint32_t histogram_bucket(uint32_t us) {
+    if(us < (1UL << HISTOGRAM_SUB_BITS)) {
+        return us;
+    }
+    if(us >= (1UL << HISTOGRAM_RANGE_BITS)) {
+        return HISTOGRAM_BUCKETS - 1;
+    }
+    uint32_t exponent = 31 - __builtin_clz(us);
+    uint32_t shift = exponent - HISTOGRAM_SUB_BITS;
+    return ((exponent - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS) +
+           ((us >> shift) & ((1UL << HISTOGRAM_SUB_BITS) - 1));
+}
+
+/**
+ * Largest value that falls into a bucket.
+ */
+static uint32_t histogram_bucket_upper(uint32_t bucket) {
+    if(bucket < (1UL << HISTOGRAM_SUB_BITS)) {
+        return bucket;
+    }
+    uint32_t shift = (bucket >> HISTOGRAM_SUB_BITS) - 1;
+    uint32_t mantissa = (1UL << HISTOGRAM_SUB_BITS) + (bucket & ((1UL << HISTOGRAM_SUB_BITS) - 1));
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void histogram_record(LifecounterHistogramId id, uint32_t us) {
+    LifecounterHistogram* histogram = &histograms[id];
+    atomic_fetch_add_explicit(&histogram->counts[histogram_bucket(us)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->total, 1, memory_order_relaxed);
+    // A racing larger sample may be lost, the buckets still have it
+    if(us > atomic_load_explicit(&histogram->max_us, memory_order_relaxed)) {
+        atomic_store_explicit(&histogram->max_us, us, memory_order_relaxed);
+    }
+}
+
+void histogram_record_cycles(LifecounterHistogramId id, uint32_t cycles) {
+    histogram_record(id, cycles / furi_hal_cortex_instructions_per_microsecond());
+}
+
+uint32_t histogram_count(LifecounterHistogramId id) {
+    return atomic_load(&histograms[id].total);
+}
+
+uint32_t histogram_percentile(LifecounterHistogramId id, uint32_t permille) {
+    LifecounterHistogram* histogram = &histograms[id];
+    uint32_t total = atomic_load(&histogram->total);
+    if(total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = ((uint64_t)total * permille + 999) / 1000;
+    uint64_t seen = 0;
+    for(uint32_t bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++) {
+        seen += atomic_load_explicit(&histogram->counts[bucket], memory_order_relaxed);
+        if(seen >= rank && seen > 0) {
+            return MIN(histogram_bucket_upper(bucket), atomic_load(&histogram->max_us));
+        }
+    }
+    return atomic_load(&histogram->max_us);
+}
+
+uint32_t histogram_max(LifecounterHistogramId id) {
+    return atomic_load(&histograms[id].max_us);
+}
+
+const char* histogram_name(LifecounterHistogramId id) {
+    return id < HistogramCount ? histogram_names[id] : "?";
+}
+
+/**
+ * Write this session's histograms after a header, added to those of a saved file if there is one.
+ *
+ * @param      file    The new file.
+ * @param      header  Header of the new file.
+ * @param      saved   Saved file positioned after its header, NULL to write this session only.
+ */
+static bool histogram_write(File* file, const LifecounterHistogramHeader* header, File* saved) {
+    uint32_t chunk[HISTOGRAM_CHUNK];
+    bool read = true;
+    size_t written = storage_file_write(file, header, sizeof(LifecounterHistogramHeader));
+
+    for(size_t h = 0; h < HistogramCount && read; h++) {
+        LifecounterHistogram* histogram = &histograms[h];
+        uint32_t max_us = 0;
+        if(saved) {
+            read = storage_file_read(saved, &max_us, sizeof(max_us)) == sizeof(max_us);
+        }
+        max_us = MAX(max_us, atomic_load(&histogram->max_us));
+        written += storage_file_write(file, &max_us, sizeof(max_us));
+        for(size_t first = 0; first < HISTOGRAM_BUCKETS && read; first += HISTOGRAM_CHUNK) {
+            size_t count = MIN((size_t)HISTOGRAM_CHUNK, HISTOGRAM_BUCKETS - first);
+            if(saved) {
+                read = storage_file_read(saved, chunk, count * sizeof(uint32_t)) == count * sizeof(uint32_t);
+            } else {
+                memset(chunk, 0, sizeof(chunk));
+            }
+            for(size_t i = 0; i < count; i++) {
+                chunk[i] += atomic_load(&histogram->counts[first + i]);
+            }
+            written += storage_file_write(file, chunk, count * sizeof(uint32_t));
+        }
+    }
+    energy_count_sd_written(written);
+    return read && written == sizeof(LifecounterHistogramHeader) +
+                                  HistogramCount * sizeof(LifecounterHistogramRecord);
+}
+
+bool histogram_save(Storage* storage, File* file, const char* path) {
+    LifecounterHistogramHeader header;
+    char temp[HISTOGRAM_PATH_SIZE];
+    uint32_t now = furi_hal_rtc_get_timestamp();
+    bool merge = false;
+    bool saved = false;
+
+    File* old = storage_file_alloc(storage);
+    if(storage_file_open(old, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        merge = storage_file_read(old, &header, sizeof(header)) == sizeof(header) &&
+                header.magic == HISTOGRAM_MAGIC && header.sub_bits == HISTOGRAM_SUB_BITS &&
+                header.histograms == HistogramCount && header.buckets == HISTOGRAM_BUCKETS;
+    }
+    if(merge) {
+        header.sessions++;
+        header.last = now;
+    } else {
+        // No file yet or one of another layout
+        header = (LifecounterHistogramHeader){
+            .magic = HISTOGRAM_MAGIC,
+            .sub_bits = HISTOGRAM_SUB_BITS,
+            .histograms = HistogramCount,
+            .buckets = HISTOGRAM_BUCKETS,
+            .sessions = 1,
+            .first = now,
+            .last = now,
+        };
+    }
+
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    if(storage_file_open(file, temp, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        saved = histogram_write(file, &header, merge ? old : NULL);
+    }
+    storage_file_close(file);
+    storage_file_close(old);
+    storage_file_free(old);
+
+    if(saved) {
+        // Only a crash between these two loses the histograms, it never leaves a half merged file
+        storage_simply_remove(storage, path);
+        saved = storage_common_rename(storage, temp, path) == FSE_OK;
+    }
+    if(!saved) {
+        FURI_LOG_E(TAG, "Failed to save histograms to %s", path);
+        storage_simply_remove(storage, temp);
+    }
+    return saved;
+}
+
+#endif
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <furi.h>
+#include <storage/storage.h>
+#include "lifecounter_features.h"
+
+#define HISTOGRAM_SUB_BITS 3 // Buckets per power of two are 2^HISTOGRAM_SUB_BITS, about 12% wide
+#define HISTOGRAM_RANGE_BITS 24 // Values from 2^HISTOGRAM_RANGE_BITS us up land in the last bucket
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_RANGE_BITS - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAGIC 0x4748434CUL // "LCHG" read as little endian
+#define HISTOGRAM_PATH_SIZE 64
+
+typedef enum {
+    HistogramInputToFrame, // From the main view receiving an input to the frame showing its update
+    HistogramDraw, // Render time of the main view
+    HistogramStorage, // Configuration reads and writes, journal flushes and worker steps
+    HistogramCount,
+} LifecounterHistogramId;
+
+/**
+ * Header of the histogram file, followed by HistogramCount LifecounterHistogramRecords.
+ */
+typedef struct {
+    uint32_t magic;
+    uint8_t sub_bits; // HISTOGRAM_SUB_BITS the file was written with
+    uint8_t histograms; // HistogramCount the file was written with
+    uint16_t buckets; // HISTOGRAM_BUCKETS the file was written with
+    uint32_t sessions; // Sessions merged into the file
+    uint32_t first; // RTC timestamp of the first session
+    uint32_t last; // RTC timestamp of the latest session
+} LifecounterHistogramHeader;
+
+typedef struct {
+    uint32_t max_us;
+    uint32_t counts[HISTOGRAM_BUCKETS];
+} LifecounterHistogramRecord;
+
+#if LIFECOUNTER_FEATURE_TRACE
+
+/**
+ * Add a sample in microseconds to the histograms of this session.
+ *
+ * @details    Finds the bucket with a count leading zeros and a shift and bumps it, safe from any
+ *             thread and never allocates.
+ */
+void histogram_record(LifecounterHistogramId id, uint32_t us);
+
+/**
+ * Add a sample in cycle counter ticks.
+ */
+void histogram_record_cycles(LifecounterHistogramId id, uint32_t cycles);
+
+/**
+ * Samples of this session.
+ */
+uint32_t histogram_count(LifecounterHistogramId id);
+
+/**
+ * Value below which the given share of this session's samples fall, the upper end of its bucket.
+ *
+ * @param      id        The histogram.
+ * @param      permille  Share of samples, 500 for the median.
+ * @return     Microseconds, 0 without samples.
+ */
+uint32_t histogram_percentile(LifecounterHistogramId id, uint32_t permille);
+
+/**
+ * Slowest sample of this session.
+ */
+uint32_t histogram_max(LifecounterHistogramId id);
+
+const char* histogram_name(LifecounterHistogramId id);
+
+/**
+ * Merge this session's histograms into the file, starting it over if its layout differs.
+ *
+ * @details    The merged histograms are streamed in small chunks into <path>.tmp, which replaces the
+ *             file once it is complete, so a merge that fails leaves the file as it was and merging
+ *             needs no more than a few dozen bytes of stack.
+ * @param      storage  Storage record.
+ * @param      file     File handle for the new file.
+ * @param      path     The histogram file.
+ * @return     true if the file was written.
+ */
+bool histogram_save(Storage* storage, File* file, const char* path);
+
+#endif
@@ -0,0 +1,185 @@
+#include "lifecounter_features.h"
+#include "lifecounter_history.h"
+#include "lifecounter_energy.h"
+#include <furi_hal.h>
+#include "lifecounter_fault.h"
+
+#if LIFECOUNTER_FEATURE_HISTORY
+
+#define TAG "Lifecounter"
+#define HISTORY_READ_BATCH 8 // Records read at once when rebuilding the aggregates
+
+static void history_save_stats(LifecounterHistory* history) {
+    LifecounterStatsRecord record = {.magic = HISTORY_STATS_MAGIC, .stats = history->stats};
+
+    if(storage_file_open(history->file, history->stats_path, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        size_t written = storage_file_write(history->file, &record, sizeof(record));
+        energy_count_sd_written(written);
+        if(written != sizeof(record)) {
+            FURI_LOG_E(TAG, "Failed to write %s", history->stats_path);
+        }
+    } else {
+        FURI_LOG_E(TAG, "Failed to open %s", history->stats_path);
+    }
+    storage_file_close(history->file);
+}
+
+/**
+ * Store the turn summary of a match at the index of the match, a gap left by a summary that
+ * couldn't be written reads as zeros.
+ */
+static void history_save_turns(LifecounterHistory* history, const LifecounterTurnRecord* record) {
+    bool stored = false;
+    if(storage_file_open(history->file, history->turns_path, FSAM_WRITE, FSOM_OPEN_ALWAYS) &&
+       storage_file_seek(history->file, record->id * sizeof(LifecounterTurnRecord), true)) {
+        size_t written = storage_file_write(history->file, record, sizeof(LifecounterTurnRecord));
+        energy_count_sd_written(written);
+        stored = written == sizeof(LifecounterTurnRecord);
+    }
+    storage_file_close(history->file);
+    if(!stored) {
+        FURI_LOG_E(TAG, "Failed to store the turns of match %lu", record->id);
+    }
+}
+
+void history_init(LifecounterHistory* history, Storage* storage, const char* dir) {
+    memset(history, 0, sizeof(LifecounterHistory));
+    history->storage = storage;
+    history->file = storage_file_alloc(storage);
+    snprintf(history->path, sizeof(history->path), "%shistory.bin", dir);
+    snprintf(history->stats_path, sizeof(history->stats_path), "%sstats.bin", dir);
+    snprintf(history->turns_path, sizeof(history->turns_path), "%sturns.bin", dir);
+
+    FileInfo info;
+    if(storage_common_stat(storage, history->path, &info) == FSE_OK) {
+        history->count = info.size / sizeof(LifecounterMatch);
+    }
+
+    LifecounterStatsRecord record;
+    bool cached = false;
+    if(storage_file_open(history->file, history->stats_path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        cached = storage_file_read(history->file, &record, sizeof(record)) == sizeof(record) &&
+                 record.magic == HISTORY_STATS_MAGIC && record.stats.matches == history->count;
+    }
+    storage_file_close(history->file);
+
+    if(cached) {
+        history->stats = record.stats;
+    } else {
+        FURI_LOG_I(TAG, "Rebuilding statistics of %lu matches", history->count);
+        history_rebuild_stats(history, &history->stats);
+        history_save_stats(history);
+    }
+}
+
+void history_deinit(LifecounterHistory* history) {
+    storage_file_free(history->file);
+}
+
+bool history_append(LifecounterHistory* history, LifecounterMatch* match) {
+    match->id = history->count;
+
+    bool stored = false;
+    if(storage_file_open(history->file, history->path, FSAM_WRITE, FSOM_OPEN_APPEND)) {
+        size_t written = storage_file_write(history->file, match, sizeof(LifecounterMatch));
+        energy_count_sd_written(written);
+        stored = written == sizeof(LifecounterMatch);
+    }
+    storage_file_close(history->file);
+    if(!stored) {
+        FURI_LOG_E(TAG, "Failed to append match %lu", match->id);
+        return false;
+    }
+
+    history->count++;
+    stats_add(&history->stats, match);
+    history_save_stats(history);
+    return true;
+}
+
+bool history_read(LifecounterHistory* history, uint32_t id, LifecounterMatch* match) {
+    if(id >= history->count) {
+        return false;
+    }
+
+    bool read = false;
+    if(storage_file_open(history->file, history->path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        read = storage_file_seek(history->file, id * sizeof(LifecounterMatch), true) &&
+               storage_file_read(history->file, match, sizeof(LifecounterMatch)) ==
+                   sizeof(LifecounterMatch);
+    }
+    storage_file_close(history->file);
+    return read;
+}
+
+bool history_rebuild_stats(LifecounterHistory* history, LifecounterStats* stats) {
+    LifecounterMatch batch[HISTORY_READ_BATCH];
+    uint32_t remaining = history->count;
+
+    stats_reset(stats);
+    if(remaining == 0) {
+        return true;
+    }
+    if(!storage_file_open(history->file, history->path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        storage_file_close(history->file);
+        return false;
+    }
+
+    while(remaining > 0) {
+        size_t want = MIN(remaining, (uint32_t)HISTORY_READ_BATCH);
+        size_t read = storage_file_read(history->file, batch, want * sizeof(LifecounterMatch)) /
+                      sizeof(LifecounterMatch);
+        for(size_t i = 0; i < read; i++) {
+            stats_add(stats, &batch[i]);
+        }
+        remaining -= read;
+        if(read < want) {
+            break;
+        }
+    }
+    storage_file_close(history->file);
+
+    if(remaining > 0) {
+        FURI_LOG_E(TAG, "History ended %lu matches early", remaining);
+        return false;
+    }
+    return true;
+}
+
+bool history_finish_game(
+    LifecounterHistory* history,
+    LifecounterJournal* journal,
+    const LifecounterModel* model,
+    const LifecounterTurns* turns) {
+    if(journal->events == 0) {
+        return false;
+    }
+
+    LifecounterMatch match = {
+        .ended = furi_hal_rtc_get_timestamp(),
+        .duration_s = journal_duration_s(journal),
+        .events = journal->events,
+        .format = journal->format_id,
+        .winner = stats_winner(model),
+        .starting_life = journal->starting_life,
+    };
+    for(size_t i = 0; i < LIFECOUNTER_PLAYERS; i++) {
+        match.final_life[i] = model->life[i];
+    }
+
+    // The id the match gets, so its journal can be found from the record
+    if(!journal_archive(journal, history->count)) {
+        return false;
+    }
+    if(!history_append(history, &match)) {
+        return false;
+    }
+    if(turns) {
+        LifecounterTurnRecord record;
+        turns_record(turns, model, match.id, &record);
+        history_save_turns(history, &record);
+    }
+    return true;
+}
+
+#endif
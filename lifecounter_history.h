@@ -0,0 +1,84 @@
+#pragma once
+
+#include <furi.h>
+#include <storage/storage.h>
+#include "lifecounter_stats.h"
+#include "lifecounter_journal.h"
+#include "lifecounter_turns.h"
+
+#define HISTORY_PATH_SIZE 64
+#define HISTORY_STATS_MAGIC 0x5453434CUL // "LCST" read as little endian
+
+/**
+ * Cached aggregates as stored next to the history file.
+ */
+typedef struct {
+    uint32_t magic;
+    LifecounterStats stats;
+} LifecounterStatsRecord;
+
+/**
+ * Store of finished matches.
+ *
+ * @details    Matches are appended as fixed size records to history.bin, so a match is found by
+ *             seeking to its id. The aggregates are updated as matches are added and cached in
+ *             stats.bin, they are only rebuilt from the records when the cache doesn't match. The turn
+ *             summaries of the matches are kept in turns.bin at the index of their match.
+ */
+typedef struct {
+    Storage* storage;
+    File* file;
+    char path[HISTORY_PATH_SIZE]; // history.bin
+    char stats_path[HISTORY_PATH_SIZE]; // stats.bin
+    char turns_path[HISTORY_PATH_SIZE]; // turns.bin
+    uint32_t count; // Matches in the store
+    LifecounterStats stats;
+} LifecounterHistory;
+
+/**
+ * Open the history in a directory and load or rebuild its aggregates.
+ *
+ * @param      history  The history.
+ * @param      storage  Storage record.
+ * @param      dir      Directory of the history files, ends with a slash.
+ */
+void history_init(LifecounterHistory* history, Storage* storage, const char* dir);
+
+void history_deinit(LifecounterHistory* history);
+
+/**
+ * Append a match, assigning its id, and update the aggregates.
+ *
+ * @return     true if the match was stored.
+ */
+bool history_append(LifecounterHistory* history, LifecounterMatch* match);
+
+/**
+ * Read the match with the given id.
+ *
+ * @return     true if the match was read.
+ */
+bool history_read(LifecounterHistory* history, uint32_t id, LifecounterMatch* match);
+
+/**
+ * Recompute the aggregates from all records in a single streaming pass.
+ *
+ * @return     true if every record was read.
+ */
+bool history_rebuild_stats(LifecounterHistory* history, LifecounterStats* stats);
+
+/**
+ * Record the game of a journal as finished: archive its journal and append its summary.
+ *
+ * @details    Games without any operation are not recorded.
+ * @param      history  The history.
+ * @param      journal  Journal of the game, archived as games/<id>.jnl.
+ * @param      model    Final state of the game.
+ * @param      turns    Turn totals of the game, stored with the match, NULL if they weren't kept.
+ * @return     true if the game was recorded.
+ */
+bool history_finish_game(
+    LifecounterHistory* history,
+    LifecounterJournal* journal,
+    const LifecounterModel* model,
+    const LifecounterTurns* turns);
@@ -0,0 +1,449 @@
+#include "lifecounter_features.h"
+#include "lifecounter_journal.h"
+#include "lifecounter_energy.h"
+#include "lifecounter_trace.h"
+#include "lifecounter_fault.h"
+
+#if LIFECOUNTER_FEATURE_HISTORY
+
+#define TAG "Lifecounter"
+#define JOURNAL_RECORD sizeof(LifecounterJournalEvent)
+
+_Static_assert(sizeof(LifecounterJournalEvent) == 8, "Journal record layout is stored on the SD card");
+_Static_assert(sizeof(LifecounterJournalHeader) == JOURNAL_RECORD, "Journal header takes one record");
+_Static_assert(sizeof(LifecounterModel) == 24, "The model is stored in journal checkpoints");
+_Static_assert(sizeof(LifecounterTurns) == 40, "The turn totals are stored in journal checkpoints");
+_Static_assert(JOURNAL_CHECKPOINT_RECORDS < JOURNAL_PENDING_EVENTS, "The first checkpoint is written with the header");
+
+/**
+ * The payload records following the first record of a checkpoint.
+ */
+typedef union {
+    LifecounterJournalCheckpoint checkpoint;
+    LifecounterJournalEvent records[JOURNAL_CHECKPOINT_RECORDS - 1];
+} LifecounterJournalCheckpointPayload;
+
+/**
+ * What a walk over the records after a checkpoint found.
+ */
+typedef struct {
+    uint32_t checkpoint; // Record of the latest checkpoint that is whole
+    uint32_t operations; // Operations after it
+    uint32_t last; // Record of the last operation, or of the checkpoint when nothing followed it
+} LifecounterJournalScan;
+
+static uint32_t journal_time_ms(const LifecounterJournal* journal) {
+    return (uint64_t)(furi_get_tick() - journal->start_tick) * 1000 / furi_kernel_get_tick_frequency();
+}
+
+static void journal_push(LifecounterJournal* journal, const LifecounterJournalEvent* record) {
+    journal->pending[journal->pending_count++] = *record;
+    journal->records++;
+
+    if(journal->pending_count == JOURNAL_PENDING_EVENTS) {
+        journal_flush(journal);
+    }
+}
+
+/**
+ * Queue a checkpoint of the state after the operations recorded so far.
+ */
+static void journal_checkpoint(
+    LifecounterJournal* journal,
+    const LifecounterModel* model,
+    const LifecounterTurns* turns) {
+    LifecounterJournalCheckpointPayload payload;
+    // A flush in the middle of the checkpoint could drop its first records and keep the others
+    if(journal->pending_count + JOURNAL_CHECKPOINT_RECORDS > JOURNAL_PENDING_EVENTS) {
+        journal_flush(journal);
+    }
+    journal->resync = false;
+    journal->since_checkpoint = 0;
+    memset(&payload, 0, sizeof(payload));
+    payload.checkpoint.events = journal->events;
+    payload.checkpoint.format_id = journal->format_id;
+    payload.checkpoint.starting_life = journal->starting_life;
+    payload.checkpoint.model = *model;
+    if(turns) {
+        payload.checkpoint.turns = *turns;
+    }
+
+    LifecounterJournalEvent record = {
+        .time_ms = journal_time_ms(journal),
+        .type = JournalEventCheckpoint,
+        .player = COUNT_OF(payload.records),
+    };
+    journal->checkpoint = journal->records;
+    journal_push(journal, &record);
+    for(size_t i = 0; i < COUNT_OF(payload.records); i++) {
+        journal_push(journal, &payload.records[i]);
+    }
+}
+
+/**
+ * Read one record of the open journal file.
+ */
+static bool journal_read_record(LifecounterJournal* journal, uint32_t record, LifecounterJournalEvent* event) {
+    return storage_file_seek(journal->file, record * JOURNAL_RECORD, true) &&
+           storage_file_read(journal->file, event, JOURNAL_RECORD) == JOURNAL_RECORD;
+}
+
+/**
+ * Read a checkpoint from the open journal file.
+ */
+static bool journal_read_checkpoint_open(
+    LifecounterJournal* journal,
+    uint32_t record,
+    LifecounterJournalCheckpoint* checkpoint) {
+    LifecounterJournalEvent first;
+    LifecounterJournalCheckpointPayload payload;
+
+    if(!journal_read_record(journal, record, &first) || first.type != JournalEventCheckpoint ||
+       first.player != COUNT_OF(payload.records)) {
+        return false;
+    }
+    if(storage_file_read(journal->file, &payload, sizeof(payload)) != sizeof(payload)) {
+        return false;
+    }
+    *checkpoint = payload.checkpoint;
+    return true;
+}
+
+void journal_init(LifecounterJournal* journal, Storage* storage, const char* dir, const char* name) {
+    memset(journal, 0, sizeof(LifecounterJournal));
+    journal->storage = storage;
+    journal->file = storage_file_alloc(storage);
+    journal->dir = dir;
+    snprintf(journal->path, sizeof(journal->path), "%s%s", dir, name);
+}
+
+void journal_deinit(LifecounterJournal* journal) {
+    journal_flush(journal);
+    storage_file_free(journal->file);
+}
+
+void journal_start(LifecounterJournal* journal, uint8_t format_id, const LifecounterModel* model) {
+    // Whatever is pending belongs to the previous game
+    journal->pending_count = 0;
+    journal->records = 0;
+    journal->events = 0;
+    journal->start_tick = furi_get_tick();
+    journal->format_id = format_id;
+    journal->starting_life = model->life[0];
+
+    LifecounterJournalHeader header = {.magic = JOURNAL_MAGIC, .checkpoint = JOURNAL_FIRST_CHECKPOINT};
+    journal->records++;
+    // Nothing happened yet, the turn totals of the first checkpoint are zero
+    journal_checkpoint(journal, model, NULL);
+    if(storage_file_open(journal->file, journal->path, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        // The header and first checkpoint go out together, so a new journal always has a checkpoint
+        size_t written = storage_file_write(journal->file, &header, sizeof(header));
+        written += storage_file_write(journal->file, journal->pending, journal->pending_count * JOURNAL_RECORD);
+        energy_count_sd_written(written);
+        if(written != journal->records * JOURNAL_RECORD) {
+            FURI_LOG_E(TAG, "Failed to write journal start");
+        }
+    } else {
+        FURI_LOG_E(TAG, "Failed to create journal");
+    }
+    storage_file_close(journal->file);
+    journal->pending_count = 0;
+    journal->checkpoint_on_card = JOURNAL_FIRST_CHECKPOINT;
+}
+
+void journal_append(
+    LifecounterJournal* journal,
+    const GameOp* op,
+    uint8_t player,
+    const LifecounterModel* model,
+    const LifecounterTurns* turns) {
+    LifecounterJournalEvent record = {
+        .time_ms = journal_time_ms(journal),
+        .type = op->type,
+        .player = player,
+        .value = op->value,
+    };
+    journal_push(journal, &record);
+    journal->events++;
+    journal->since_checkpoint++;
+
+    if(journal->resync || journal->since_checkpoint >= JOURNAL_CHECKPOINT_INTERVAL) {
+        journal_checkpoint(journal, model, turns);
+    }
+}
+
+void journal_flush(LifecounterJournal* journal) {
+    if(journal->pending_count == 0) {
+        return;
+    }
+
+    uint32_t trace_start = trace_begin();
+    size_t size = journal->pending_count * JOURNAL_RECORD;
+    uint32_t offset = (journal->records - journal->pending_count) * JOURNAL_RECORD;
+    bool appended = false;
+    if(storage_file_open(journal->file, journal->path, FSAM_READ_WRITE, FSOM_OPEN_EXISTING)) {
+        // Seek rather than append so a torn record left by a crash is overwritten
+        appended = storage_file_seek(journal->file, offset, true);
+        size_t written = appended ? storage_file_write(journal->file, journal->pending, size) : 0;
+        energy_count_sd_written(written);
+        appended = written == size;
+
+        // Point the header at a new checkpoint only once all of it is on the card, a flush can
+        // come in the middle of a checkpoint when the pending buffer fills up
+        bool checkpoint_written = journal->checkpoint + JOURNAL_CHECKPOINT_RECORDS <= journal->records;
+        if(appended && checkpoint_written && journal->checkpoint != journal->checkpoint_on_card) {
+            LifecounterJournalHeader header = {.magic = JOURNAL_MAGIC, .checkpoint = journal->checkpoint};
+            if(storage_file_seek(journal->file, 0, true) &&
+               storage_file_write(journal->file, &header, sizeof(header)) == sizeof(header)) {
+                journal->checkpoint_on_card = journal->checkpoint;
+                energy_count_sd_written(sizeof(header));
+            }
+        }
+        if(!appended) {
+            FURI_LOG_E(TAG, "Failed to append to journal");
+        }
+    } else {
+        FURI_LOG_E(TAG, "Failed to open journal");
+    }
+    storage_file_close(journal->file);
+    journal->pending_count = 0;
+    if(!appended) {
+        // Whatever part of the batch got to the card is written over by the next flush, the game
+        // is written as a checkpoint there so the operations of the batch aren't lost
+        journal->records = offset / JOURNAL_RECORD;
+        if(journal->checkpoint + JOURNAL_CHECKPOINT_RECORDS > journal->records) {
+            journal->checkpoint = journal->checkpoint_on_card;
+        }
+        journal->resync = true;
+    }
+    trace_end(TracePointJournalFlush, trace_start);
+}
+
+bool journal_sync(LifecounterJournal* journal, const LifecounterModel* model, const LifecounterTurns* turns) {
+    journal_flush(journal);
+    for(size_t i = 0; i < JOURNAL_SYNC_ATTEMPTS && journal->resync; i++) {
+        journal_checkpoint(journal, model, turns);
+        journal_flush(journal);
+    }
+    if(journal->resync) {
+        FURI_LOG_E(TAG, "Journal doesn't cover the game, %lu operations", journal->events);
+    }
+    return !journal->resync;
+}
+
+/**
+ * Walk the records of the open journal file from a record, following the checkpoints.
+ *
+ * @details    The walk stops at a checkpoint that is cut short or not of this version, so what
+ *             comes after a crash in the middle of a checkpoint is left out.
+ * @return     The record after the last operation or whole checkpoint.
+ */
+static uint32_t journal_scan(
+    LifecounterJournal* journal,
+    uint32_t record,
+    uint32_t records,
+    LifecounterJournalScan* scan) {
+    LifecounterJournalEvent batch[JOURNAL_PENDING_EVENTS];
+    uint32_t checkpoint = 0;
+    uint32_t skip = 0;
+    uint32_t end = record;
+
+    if(!storage_file_seek(journal->file, record * JOURNAL_RECORD, true)) {
+        return end;
+    }
+    while(record < records) {
+        size_t want = MIN(records - record, (uint32_t)COUNT_OF(batch));
+        size_t read = storage_file_read(journal->file, batch, want * JOURNAL_RECORD) / JOURNAL_RECORD;
+        for(size_t i = 0; i < read; i++, record++) {
+            if(skip > 0) {
+                if(--skip == 0) {
+                    *scan = (LifecounterJournalScan){.checkpoint = checkpoint, .last = checkpoint};
+                    end = record + 1;
+                }
+            } else if(batch[i].type == JournalEventCheckpoint) {
+                if(batch[i].player != JOURNAL_CHECKPOINT_RECORDS - 1) {
+                    return end;
+                }
+                checkpoint = record;
+                skip = batch[i].player;
+            } else {
+                scan->operations++;
+                scan->last = record;
+                end = record + 1;
+            }
+        }
+        if(read < want) {
+            break;
+        }
+    }
+    return end;
+}
+
+bool journal_resume(LifecounterJournal* journal, LifecounterJournalCheckpoint* checkpoint, uint32_t* tail) {
+    LifecounterJournalHeader header;
+    LifecounterJournalEvent last;
+    LifecounterJournalScan scan = {0};
+    uint32_t records = 0;
+    bool resumed = false;
+
+    if(storage_file_open(journal->file, journal->path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        records = storage_file_size(journal->file) / JOURNAL_RECORD;
+        resumed = storage_file_read(journal->file, &header, sizeof(header)) == sizeof(header) &&
+                  header.magic == JOURNAL_MAGIC;
+        if(resumed && (header.checkpoint + JOURNAL_CHECKPOINT_RECORDS > records ||
+                       !journal_read_checkpoint_open(journal, header.checkpoint, checkpoint))) {
+            // The header got to the card but the checkpoint didn't, replay the game from its start
+            FURI_LOG_W(TAG, "Journal checkpoint %lu is missing", header.checkpoint);
+            header.checkpoint = JOURNAL_FIRST_CHECKPOINT;
+            resumed = journal_read_checkpoint_open(journal, header.checkpoint, checkpoint);
+        }
+
+        if(resumed) {
+            // The header is moved on by every flush that completes a checkpoint, so this walks about
+            // one interval. A later checkpoint the header missed, or the one written after a failed
+            // flush, is taken instead, a checkpoint cut short by a crash is left out.
+            scan = (LifecounterJournalScan){.checkpoint = header.checkpoint, .last = header.checkpoint};
+            records = journal_scan(journal, header.checkpoint + JOURNAL_CHECKPOINT_RECORDS, records, &scan);
+            if(scan.checkpoint != header.checkpoint) {
+                resumed = journal_read_checkpoint_open(journal, scan.checkpoint, checkpoint);
+            }
+            // Time of the last operation, or of the checkpoint when nothing followed it
+            resumed = resumed && journal_read_record(journal, scan.last, &last);
+        }
+    }
+    storage_file_close(journal->file);
+    if(!resumed) {
+        return false;
+    }
+
+    *tail = scan.checkpoint + JOURNAL_CHECKPOINT_RECORDS;
+    journal->pending_count = 0;
+    journal->records = records;
+    // A later checkpoint the header missed is used from now on, the next flush points the header at it
+    journal->checkpoint = scan.checkpoint;
+    journal->checkpoint_on_card = header.checkpoint;
+    journal->events = checkpoint->events + scan.operations;
+    journal->since_checkpoint = scan.operations;
+    journal->resync = false;
+    journal->format_id = checkpoint->format_id;
+    journal->starting_life = checkpoint->starting_life;
+    // Time the app was closed doesn't count towards the game
+    journal->start_tick = furi_get_tick() - furi_ms_to_ticks(last.time_ms);
+    return true;
+}
+
+void journal_resume_finish(LifecounterJournal* journal, const LifecounterModel* model, const LifecounterTurns* turns) {
+    // A crash cut the checkpoint after the last full interval short
+    if(journal->since_checkpoint >= JOURNAL_CHECKPOINT_INTERVAL) {
+        journal_checkpoint(journal, model, turns);
+    }
+}
+
+bool journal_read_checkpoint(LifecounterJournal* journal, uint32_t record, LifecounterJournalCheckpoint* checkpoint) {
+    journal_flush(journal);
+    bool read = storage_file_open(journal->file, journal->path, FSAM_READ, FSOM_OPEN_EXISTING) &&
+                journal_read_checkpoint_open(journal, record, checkpoint);
+    storage_file_close(journal->file);
+    return read;
+}
+
+/**
+ * Replay records of the open journal file from a cursor.
+ *
+ * @return     Number of operations replayed.
+ */
+static uint32_t journal_replay_open(
+    LifecounterJournal* journal,
+    LifecounterJournalCursor* cursor,
+    uint32_t max_records,
+    LifecounterJournalCallback callback,
+    void* context) {
+    LifecounterJournalEvent batch[JOURNAL_PENDING_EVENTS];
+    uint32_t end = cursor->record + MIN(max_records, journal->records - cursor->record);
+    uint32_t replayed = 0;
+
+    if(!storage_file_seek(journal->file, cursor->record * JOURNAL_RECORD, true)) {
+        cursor->record = journal->records;
+        return 0;
+    }
+    while(cursor->record < end) {
+        size_t want = MIN(end - cursor->record, (uint32_t)COUNT_OF(batch));
+        size_t read = storage_file_read(journal->file, batch, want * JOURNAL_RECORD) / JOURNAL_RECORD;
+        for(size_t i = 0; i < read; i++) {
+            if(cursor->skip > 0) {
+                cursor->skip--;
+            } else if(batch[i].type == JournalEventCheckpoint) {
+                cursor->skip = batch[i].player;
+            } else {
+                callback(&batch[i], context);
+                replayed++;
+            }
+        }
+        cursor->record += read;
+        if(read < want) {
+            FURI_LOG_E(TAG, "Journal ended early at record %lu", cursor->record);
+            cursor->record = journal->records;
+            break;
+        }
+    }
+    return replayed;
+}
+
+uint32_t journal_replay(
+    LifecounterJournal* journal,
+    uint32_t record,
+    LifecounterJournalCallback callback,
+    void* context) {
+    LifecounterJournalCursor cursor = {.record = record};
+    uint32_t replayed = 0;
+
+    journal_flush(journal);
+    if(storage_file_open(journal->file, journal->path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        replayed = journal_replay_open(journal, &cursor, UINT32_MAX, callback, context);
+    }
+    storage_file_close(journal->file);
+    return replayed;
+}
+
+bool journal_replay_step(
+    LifecounterJournal* journal,
+    LifecounterJournalCursor* cursor,
+    uint32_t max_records,
+    LifecounterJournalCallback callback,
+    void* context) {
+    journal_flush(journal);
+    if(storage_file_open(journal->file, journal->path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        journal_replay_open(journal, cursor, max_records, callback, context);
+    } else {
+        cursor->record = journal->records;
+    }
+    storage_file_close(journal->file);
+    return cursor->record >= journal->records;
+}
+
+void journal_open_archive(LifecounterJournal* journal, uint32_t id) {
+    journal->pending_count = 0;
+    journal->records = 0;
+    snprintf(journal->path, sizeof(journal->path), "%sgames/%lu.jnl", journal->dir, id);
+}
+
+bool journal_archive(LifecounterJournal* journal, uint32_t id) {
+    char path[JOURNAL_PATH_SIZE];
+
+    journal_flush(journal);
+    snprintf(path, sizeof(path), "%sgames", journal->dir);
+    storage_simply_mkdir(journal->storage, path);
+    snprintf(path, sizeof(path), "%sgames/%lu.jnl", journal->dir, id);
+    FS_Error error = storage_common_rename(journal->storage, journal->path, path);
+    if(error != FSE_OK) {
+        FURI_LOG_E(TAG, "Failed to archive journal as %s: %d", path, error);
+        return false;
+    }
+    return true;
+}
+
+uint32_t journal_duration_s(const LifecounterJournal* journal) {
+    return (furi_get_tick() - journal->start_tick) / furi_kernel_get_tick_frequency();
+}
+
+#endif
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <furi.h>
+#include <storage/storage.h>
+#include "lifecounter_game.h"
+#include "lifecounter_turns.h"
+
+#define JOURNAL_PENDING_EVENTS 16 // Events buffered in RAM before they are appended to the file
+#define JOURNAL_PATH_SIZE 64
+#define JOURNAL_FILENAME "journal.bin" // Journal of the current game, of the first table with several
+#define JOURNAL_MAGIC 0x314A434CUL // "LCJ1" read as little endian
+#define JOURNAL_CHECKPOINT_INTERVAL 64 // Operations between checkpoints, bounds the tail to replay
+#define JOURNAL_FIRST_CHECKPOINT 1 // Record of the checkpoint written when the game starts
+#define JOURNAL_SYNC_ATTEMPTS 3 // Checkpoints written by journal_sync() before it gives up on the card
+
+typedef enum {
+    JournalEventCheckpoint = 0x80, // player is the number of records holding the checkpoint that follow
+} LifecounterJournalEventType;
+
+/**
+ * One journal record as stored on the SD card. Types below 0x80 are GameOpTypes.
+ */
+typedef struct {
+    uint32_t time_ms; // Time since the game started
+    uint8_t type;
+    uint8_t player; // Player selected when the operation was applied
+    int16_t value;
+} LifecounterJournalEvent;
+
+/**
+ * First record of a journal file.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t checkpoint; // Record of the latest checkpoint that is completely on the card
+} LifecounterJournalHeader;
+
+/**
+ * Complete game state, written into the journal every JOURNAL_CHECKPOINT_INTERVAL operations and
+ * after a flush that failed.
+ */
+typedef struct {
+    uint32_t events; // Operations before the checkpoint
+    uint8_t format_id; // LifecounterFormatId of the game
+    uint8_t reserved;
+    int16_t starting_life;
+    LifecounterModel model;
+    LifecounterTurns turns; // Turn totals as of the checkpoint
+} LifecounterJournalCheckpoint;
+
+#define JOURNAL_CHECKPOINT_RECORDS \
+    (1 + (sizeof(LifecounterJournalCheckpoint) + sizeof(LifecounterJournalEvent) - 1) / sizeof(LifecounterJournalEvent))
+
+/**
+ * Position of a replay that is done in steps.
+ */
+typedef struct {
+    uint32_t record; // Next record to read
+    uint32_t skip; // Records of a checkpoint still to skip
+} LifecounterJournalCursor;
+
+/**
+ * Called for every operation replayed from the journal.
+ */
+typedef void (*LifecounterJournalCallback)(const LifecounterJournalEvent* event, void* context);
+
+/**
+ * Append-only log of everything that happened in the current game.
+ *
+ * @details    The file starts with a header, followed by a checkpoint of the starting state and the
+ *             operations applied since. Another checkpoint follows every JOURNAL_CHECKPOINT_INTERVAL
+ *             operations and the header is updated to point to it once it is on the card, so a game
+ *             is resumed by reading the header, the latest checkpoint and at most one interval of
+ *             operations, however long the game is. Events are collected in a small RAM buffer and
+ *             appended in batches. When a batch doesn't make it to the card the file is taken back
+ *             to the records before it and the next append writes a checkpoint of the game, so the
+ *             file never has a hole and a resume gets the operations of the lost batch back from
+ *             that checkpoint. Only used from one thread.
+ */
+typedef struct {
+    Storage* storage;
+    File* file;
+    const char* dir; // Directory holding the journal and the archived games, ends with a slash
+    char path[JOURNAL_PATH_SIZE]; // Journal of the current game
+    LifecounterJournalEvent pending[JOURNAL_PENDING_EVENTS];
+    uint8_t pending_count;
+    uint32_t records; // Records of the file, including pending ones
+    uint32_t checkpoint; // Record of the latest checkpoint
+    uint32_t checkpoint_on_card; // Latest checkpoint the header on the card points to
+    uint32_t events; // Operations in the current game, including pending ones
+    uint32_t since_checkpoint; // Operations after the latest checkpoint
+    bool resync; // A flush failed, the game is written as a checkpoint with the next append
+    uint32_t start_tick; // Tick the current game started
+    uint8_t format_id; // LifecounterFormatId of the current game
+    int16_t starting_life;
+} LifecounterJournal;
+
+/**
+ * Set up a journal.
+ *
+ * @param      journal  The journal.
+ * @param      storage  Storage record.
+ * @param      dir      Directory for the journal files, ends with a slash. Must outlive the journal.
+ * @param      name     File name of the journal of the current game in dir.
+ */
+void journal_init(LifecounterJournal* journal, Storage* storage, const char* dir, const char* name);
+
+/**
+ * Flush pending events and release the file handle.
+ */
+void journal_deinit(LifecounterJournal* journal);
+
+/**
+ * Start the journal of a new game, replacing the previous one.
+ *
+ * @param      journal  The journal.
+ * @param      format_id  LifecounterFormatId of the game.
+ * @param      model    State the game starts from, written as the first checkpoint.
+ */
+void journal_start(LifecounterJournal* journal, uint8_t format_id, const LifecounterModel* model);
+
+/**
+ * Record an applied operation.
+ *
+ * @param      journal  The journal.
+ * @param      op       The operation.
+ * @param      player   The player that was selected when the operation was applied.
+ * @param      model    State after the operation, written when a checkpoint is due.
+ * @param      turns    Turn totals after the operation, written when a checkpoint is due.
+ */
+void journal_append(
+    LifecounterJournal* journal,
+    const GameOp* op,
+    uint8_t player,
+    const LifecounterModel* model,
+    const LifecounterTurns* turns);
+
+/**
+ * Append the buffered events to the journal file.
+ *
+ * @details    The buffered events are dropped when they can't be written, see journal_sync().
+ */
+void journal_flush(LifecounterJournal* journal);
+
+/**
+ * Append the buffered events and make sure the journal file covers the game.
+ *
+ * @details    When a flush fails the operations of the lost batch are only in the game, so a
+ *             checkpoint of it is written and flushed, up to JOURNAL_SYNC_ATTEMPTS times.
+ * @param      journal  The journal.
+ * @param      model    Current state of the game.
+ * @param      turns    Current turn totals of the game.
+ * @return     true if the journal file covers the game.
+ */
+bool journal_sync(LifecounterJournal* journal, const LifecounterModel* model, const LifecounterTurns* turns);
+
+/**
+ * Pick up the game left in the journal file.
+ *
+ * @details    Reads the header and the checkpoint it points to, then walks the records after it for
+ *             a later checkpoint the header missed. The operations after the latest one are replayed
+ *             with journal_replay() starting at tail, and the resume is completed with
+ *             journal_resume_finish().
+ * @param      journal     The journal, appends continue the resumed game.
+ * @param      checkpoint  Filled with the latest checkpoint.
+ * @param      tail        Filled with the first record after the checkpoint.
+ * @return     true if there was a game to resume.
+ */
+bool journal_resume(LifecounterJournal* journal, LifecounterJournalCheckpoint* checkpoint, uint32_t* tail);
+
+/**
+ * Complete a resume once the tail has been replayed.
+ *
+ * @param      journal  The journal.
+ * @param      model    State after the replayed operations.
+ * @param      turns    Turn totals after the replayed operations.
+ */
+void journal_resume_finish(LifecounterJournal* journal, const LifecounterModel* model, const LifecounterTurns* turns);
+
+/**
+ * Read the checkpoint at a record of the journal file.
+ *
+ * @return     true if a checkpoint was read.
+ */
+bool journal_read_checkpoint(LifecounterJournal* journal, uint32_t record, LifecounterJournalCheckpoint* checkpoint);
+
+/**
+ * Replay the operations in the journal file from a record to the end, skipping checkpoints.
+ *
+ * @return     Number of operations replayed.
+ */
+uint32_t journal_replay(
+    LifecounterJournal* journal,
+    uint32_t record,
+    LifecounterJournalCallback callback,
+    void* context);
+
+/**
+ * Replay at most max_records records of the journal file from a cursor, skipping checkpoints.
+ *
+ * @return     true once the end of the journal has been reached.
+ */
+bool journal_replay_step(
+    LifecounterJournal* journal,
+    LifecounterJournalCursor* cursor,
+    uint32_t max_records,
+    LifecounterJournalCallback callback,
+    void* context);
+
+/**
+ * Point the journal at an archived game so it can be read with journal_resume() and the replays.
+ */
+void journal_open_archive(LifecounterJournal* journal, uint32_t id);
+
+/**
+ * Move the journal of the current game to games/<id>.jnl in the journal directory.
+ *
+ * @return     true if the journal was archived.
+ */
+bool journal_archive(LifecounterJournal* journal, uint32_t id);
+
+/**
+ * Seconds since the current game started.
+ */
+uint32_t journal_duration_s(const LifecounterJournal* journal);
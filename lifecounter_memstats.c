@@ -0,0 +1,96 @@
+#include "lifecounter_memstats.h"
+
+#define TAG "Lifecounter"
+
+static const char* phase_names[] = {"Startup", "Main", "Menu", "Settings", "Save"};
+
+static LifecounterMemStats stats;
+
+void memstats_init(void) {
+    memset(&stats, 0, sizeof(stats));
+    stats.app_thread = furi_thread_get_current_id();
+    stats.heap_baseline = memmgr_get_free_heap();
+    stats.stack_free_min = LIFECOUNTER_STACK_SIZE;
+    stats.phase = LifecounterPhaseStartup;
+}
+
+LifecounterPhase memstats_set_phase(LifecounterPhase phase) {
+    LifecounterPhase previous = stats.phase;
+    memstats_sample();
+    stats.phase = phase;
+    stats.phase_heap_start = stats.heap_used;
+    return previous;
+}
+
+void memstats_sample(void) {
+    size_t free_heap = memmgr_get_free_heap();
+    // Other applications and services share the heap, so usage can dip below our baseline
+    stats.heap_used = free_heap < stats.heap_baseline ? stats.heap_baseline - free_heap : 0;
+    if(stats.heap_used > stats.heap_peak) {
+        stats.heap_peak = stats.heap_used;
+    }
+    LifecounterPhaseStats* phase = &stats.phases[stats.phase];
+    if(stats.heap_used > phase->heap_peak) {
+        phase->heap_peak = stats.heap_used;
+    }
+    if(stats.heap_used > stats.phase_heap_start + phase->heap_growth) {
+        phase->heap_growth = stats.heap_used - stats.phase_heap_start;
+    }
+
+    if(furi_thread_get_current_id() == stats.app_thread) {
+        size_t stack_free = furi_thread_get_stack_space(stats.app_thread);
+        if(stack_free < stats.stack_free_min) {
+            stats.stack_free_min = stack_free;
+        }
+    }
+}
+
+const LifecounterMemStats* memstats_get(void) {
+    return &stats;
+}
+
+const char* memstats_phase_name(LifecounterPhase phase) {
+    furi_assert(phase < LifecounterPhaseCount);
+    return phase_names[phase];
+}
+
+bool memstats_report(void) {
+    memstats_sample();
+
+    size_t stack_used = LIFECOUNTER_STACK_SIZE - stats.stack_free_min;
+    FURI_LOG_I(
+        TAG,
+        "memstats heap_peak=%zu heap_budget=%u stack_used=%zu stack_budget=%u",
+        stats.heap_peak,
+        LIFECOUNTER_HEAP_BUDGET,
+        stack_used,
+        LIFECOUNTER_STACK_BUDGET);
+    for(size_t i = 0; i < LifecounterPhaseCount; i++) {
+        FURI_LOG_I(
+            TAG,
+            "memstats phase=%s heap_peak=%zu heap_growth=%zu",
+            phase_names[i],
+            stats.phases[i].heap_peak,
+            stats.phases[i].heap_growth);
+    }
+
+    bool within_budget = true;
+    if(stats.heap_peak > LIFECOUNTER_HEAP_BUDGET) {
+        FURI_LOG_E(TAG, "Heap budget exceeded: %zu > %u", stats.heap_peak, LIFECOUNTER_HEAP_BUDGET);
+        within_budget = false;
+    }
+    // All game state lives in the app arena, playing must not grow the heap. Only sampled use is
+    // seen, an allocation freed again before the next sample goes unnoticed.
+    if(stats.phases[LifecounterPhaseMain].heap_growth > LIFECOUNTER_STEADY_HEAP_SLACK) {
+        FURI_LOG_E(
+            TAG,
+            "Heap grew by %zu bytes while playing",
+            stats.phases[LifecounterPhaseMain].heap_growth);
+        within_budget = false;
+    }
+    if(stack_used > LIFECOUNTER_STACK_BUDGET) {
+        FURI_LOG_E(TAG, "Stack budget exceeded: %zu > %u", stack_used, LIFECOUNTER_STACK_BUDGET);
+        within_budget = false;
+    }
+    return within_budget;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <furi.h>
+
+/**
+ * Stack size of the application thread, keep in sync with `stack_size` in application.fam.
+ */
+#define LIFECOUNTER_STACK_SIZE (2 * 1024)
+
+/**
+ * Memory budgets checked when the application exits. Exceeding one of them is logged as an error
+ * so that a change pushing against the limits shows up in the logs of every test run.
+ */
+#define LIFECOUNTER_HEAP_BUDGET (8 * 1024)
+#define LIFECOUNTER_STACK_BUDGET (LIFECOUNTER_STACK_SIZE - 256)
+// Heap growth tolerated while playing, other threads allocate from the same heap between samples
+#define LIFECOUNTER_STEADY_HEAP_SLACK 256
+
+/**
+ * Phases of the application the heap usage is attributed to.
+ */
+typedef enum {
+    LifecounterPhaseStartup,
+    LifecounterPhaseMain,
+    LifecounterPhaseMenu,
+    LifecounterPhaseSettings,
+    LifecounterPhaseSave,
+    LifecounterPhaseCount,
+} LifecounterPhase;
+
+typedef struct {
+    size_t heap_peak; // Highest heap usage seen while in this phase
+    size_t heap_growth; // Most the heap usage rose above where it was when the phase was entered
+} LifecounterPhaseStats;
+
+typedef struct {
+    FuriThreadId app_thread; // Thread whose stack high-water mark is tracked
+    size_t heap_baseline; // Free heap when the application started
+    size_t heap_used; // Heap used by the application at the last sample
+    size_t heap_peak; // Highest heap usage over the whole session
+    size_t stack_free_min; // Lowest free stack space seen on the app thread
+    LifecounterPhase phase;
+    size_t phase_heap_start; // Heap usage when the current phase was entered
+    LifecounterPhaseStats phases[LifecounterPhaseCount];
+} LifecounterMemStats;
+
+/**
+ * Start collecting statistics, must be called from the application thread.
+ */
+void memstats_init(void);
+
+/**
+ * Switch the phase new samples are attributed to.
+ *
+ * @param      phase  The phase the application entered.
+ * @return     The phase that was active before.
+ */
+LifecounterPhase memstats_set_phase(LifecounterPhase phase);
+
+/**
+ * Sample current heap use and, when called from the application thread, the stack high-water mark.
+ *
+ * @details    The heap is read from the allocator, so every allocation between two samples shows up,
+ *             whether the app, the SDK or another thread made it.
+ */
+void memstats_sample(void);
+
+/**
+ * Get the collected statistics.
+ */
+const LifecounterMemStats* memstats_get(void);
+
+/**
+ * Human readable name of a phase.
+ */
+const char* memstats_phase_name(LifecounterPhase phase);
+
+/**
+ * Log the statistics in a greppable `memstats key=value` format and check them against the budgets.
+ *
+ * @return     true if all numbers are within budget, false otherwise.
+ */
+bool memstats_report(void);
@@ -0,0 +1,128 @@
+#include "lifecounter_power.h"
+#include <notification/notification_messages.h>
+
+#define TAG "Lifecounter"
+
+// Backlight timeout of the firmware, used to estimate lit time for the automatic profile
+#define POWER_AUTO_TIMEOUT_MS 30000
+// Brightness while dimmed, out of 255
+#define POWER_DIM_BRIGHTNESS 0x18
+
+static const char* profile_names[] = {"Auto", "On", "Dim 15s", "Dim 30s", "Dim 60s"};
+
+static const uint32_t profile_idle_ms[] = {0, 0, 15000, 30000, 60000};
+
+static const NotificationMessage message_display_backlight_dim = {
+    .type = NotificationMessageTypeLedDisplayBacklight,
+    .data.led.value = POWER_DIM_BRIGHTNESS,
+};
+
+static const NotificationSequence sequence_display_backlight_dim = {
+    &message_display_backlight_dim,
+    NULL,
+};
+
+static uint32_t power_ticks_to_ms(uint32_t ticks) {
+    return (uint64_t)ticks * 1000 / furi_kernel_get_tick_frequency();
+}
+
+/**
+ * Account the lit time up to now.
+ */
+static void power_account(LifecounterPower* power, uint32_t now) {
+    if(power->dimmed) {
+        return;
+    }
+    uint32_t lit = power_ticks_to_ms(now - power->lit_since);
+    if(power->profile == PowerProfileAuto) {
+        // The firmware turns the backlight off on its own, we only know when we saw input
+        uint32_t idle = power_ticks_to_ms(now - power->last_activity);
+        if(idle > POWER_AUTO_TIMEOUT_MS) {
+            lit -= MIN(lit, idle - POWER_AUTO_TIMEOUT_MS);
+        }
+    }
+    power->lit_ms += lit;
+    power->lit_since = now;
+}
+
+static void power_wake(LifecounterPower* power, uint32_t now) {
+    power->dimmed = false;
+    power->lit_since = now;
+    notification_message(power->notifications, &sequence_display_backlight_on);
+}
+
+void power_init(LifecounterPower* power, NotificationApp* notifications, LifecounterPowerProfile profile) {
+    memset(power, 0, sizeof(LifecounterPower));
+    power->notifications = notifications;
+    power->last_activity = furi_get_tick();
+    power->lit_since = power->last_activity;
+    power->profile = PowerProfileAuto;
+    power_set_profile(power, profile);
+}
+
+void power_deinit(LifecounterPower* power) {
+    power_account(power, furi_get_tick());
+    notification_message(power->notifications, &sequence_display_backlight_enforce_auto);
+    FURI_LOG_I(TAG, "power backlight_on_ms=%lu", power->lit_ms);
+}
+
+void power_set_profile(LifecounterPower* power, LifecounterPowerProfile profile) {
+    if(profile >= PowerProfileCount) {
+        profile = PowerProfileAuto;
+    }
+    uint32_t now = furi_get_tick();
+    power_account(power, now);
+    power->profile = profile;
+    power->last_activity = now;
+
+    if(profile == PowerProfileAuto) {
+        notification_message(power->notifications, &sequence_display_backlight_enforce_auto);
+    } else {
+        notification_message(power->notifications, &sequence_display_backlight_enforce_on);
+    }
+    if(power->dimmed) {
+        power_wake(power, now);
+    }
+}
+
+void power_set_active(LifecounterPower* power, bool active) {
+    power->active = active;
+    power_activity(power);
+}
+
+void power_activity(LifecounterPower* power) {
+    uint32_t now = furi_get_tick();
+    power_account(power, now);
+    power->last_activity = now;
+    if(power->dimmed) {
+        power_wake(power, now);
+    }
+}
+
+void power_tick(LifecounterPower* power) {
+    uint32_t idle_ms = profile_idle_ms[power->profile];
+    if(!power->active || power->dimmed || idle_ms == 0) {
+        return;
+    }
+    uint32_t now = furi_get_tick();
+    if(power_ticks_to_ms(now - power->last_activity) >= idle_ms) {
+        power_account(power, now);
+        power->dimmed = true;
+        notification_message(power->notifications, &sequence_display_backlight_dim);
+    }
+}
+
+uint32_t power_backlight_on_ms(const LifecounterPower* power) {
+    if(power->dimmed) {
+        return power->lit_ms;
+    }
+    // Include the running lit period without mutating the controller
+    LifecounterPower snapshot = *power;
+    power_account(&snapshot, furi_get_tick());
+    return snapshot.lit_ms;
+}
+
+const char* power_profile_name(LifecounterPowerProfile profile) {
+    furi_assert(profile < PowerProfileCount);
+    return profile_names[profile];
+}
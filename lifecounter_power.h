@@ -0,0 +1,67 @@
+#pragma once
+
+#include <furi.h>
+#include <notification/notification.h>
+
+/**
+ * Backlight power profiles selectable in the settings.
+ */
+typedef enum {
+    PowerProfileAuto, // Firmware decides, like any other app
+    PowerProfileOn, // Always fully lit
+    PowerProfileDim15, // Fully lit while active, dimmed after 15 s idle
+    PowerProfileDim30,
+    PowerProfileDim60,
+    PowerProfileCount,
+} LifecounterPowerProfile;
+
+/**
+ * Backlight controller, only used from the view dispatcher thread.
+ */
+typedef struct {
+    NotificationApp* notifications; // Held for the lifetime of the app
+    LifecounterPowerProfile profile;
+    bool active; // Dimming is allowed, i.e. the main view is shown
+    bool dimmed;
+    uint32_t last_activity; // Tick of the last input
+    uint32_t lit_since; // Tick the backlight was last turned fully on
+    uint32_t lit_ms; // Fully lit time accumulated before lit_since
+} LifecounterPower;
+
+/**
+ * Set up the controller and apply a profile.
+ *
+ * @param      power          The controller.
+ * @param      notifications  Notification record, must stay open until power_deinit.
+ * @param      profile        The profile to apply.
+ */
+void power_init(LifecounterPower* power, NotificationApp* notifications, LifecounterPowerProfile profile);
+
+/**
+ * Give the backlight back to the firmware.
+ */
+void power_deinit(LifecounterPower* power);
+
+void power_set_profile(LifecounterPower* power, LifecounterPowerProfile profile);
+
+/**
+ * Allow or forbid dimming, leaving the main view always wakes the display.
+ */
+void power_set_active(LifecounterPower* power, bool active);
+
+/**
+ * Record user activity and wake a dimmed display. The input itself is still processed by the caller.
+ */
+void power_activity(LifecounterPower* power);
+
+/**
+ * Periodic check, dims the display when the idle period of the profile has passed.
+ */
+void power_tick(LifecounterPower* power);
+
+/**
+ * Milliseconds the backlight has been fully lit in this session.
+ */
+uint32_t power_backlight_on_ms(const LifecounterPower* power);
+
+const char* power_profile_name(LifecounterPowerProfile profile);
@@ -0,0 +1,433 @@
+#include "lifecounter_features.h"
+#include "lifecounter_remote.h"
+#include "lifecounter_fault.h"
+
+#if LIFECOUNTER_FEATURE_DIAGNOSTICS
+
+#include <cli/cli.h>
+#include <input/input.h>
+#include <toolbox/args.h>
+
+#define TAG "Lifecounter"
+#define REMOTE_SOAK_STACK_SIZE 1024
+#define REMOTE_SOAK_PROGRESS 1000 // Presses between progress lines
+#define REMOTE_SOAK_SEED 0x2545F491UL
+
+// Outlive the app, a command the CLI started just before remote_deinit() may only look at these
+static atomic_uint remote_running; // Commands running on the CLI thread
+static LifecounterRemote* _Atomic remote_open; // The remote commands work on, NULL once it is closing
+
+/**
+ * Whether remote_deinit() was called, running commands stop early.
+ */
+static bool remote_closing(void) {
+    return atomic_load(&remote_open) == NULL;
+}
+
+static const struct {
+    const char* name;
+    InputKey key;
+} remote_keys[] = {
+    {"up", InputKeyUp},
+    {"down", InputKeyDown},
+    {"left", InputKeyLeft},
+    {"right", InputKeyRight},
+    {"ok", InputKeyOk},
+    {"back", InputKeyBack},
+};
+
+/**
+ * State of a soak run, shared between the CLI thread and the checker.
+ */
+typedef struct {
+    LifecounterRemote* remote;
+    LifecounterGame* game; // Game of the table shown when the run started
+    LifecounterModel start; // Game when the run started, the presses keep it close to it
+    uint32_t backlog_start; // Redraw events lost on other views before the run
+    atomic_bool stop;
+    // Only touched by the checker until it has been joined
+    uint32_t reads;
+    uint32_t ticks;
+    uint32_t invalid;
+    int32_t backlog_max;
+    uint32_t backlog_overruns;
+} LifecounterRemoteSoak;
+
+static void remote_usage(void) {
+    printf("Usage:\r\n");
+    printf(REMOTE_COMMAND " press <up|down|left|right|ok|back> [short|long]\r\n");
+    printf("\tinject a press, wait for its frame and print the cycle counter at each stage\r\n");
+    printf(REMOTE_COMMAND " soak [presses]\r\n");
+    printf("\tsend random presses while another thread checks the game and runs timer ticks\r\n");
+    printf(REMOTE_COMMAND " state\r\n");
+    printf(REMOTE_COMMAND " probe\r\n");
+    printf(REMOTE_COMMAND " info\r\n");
+#if LIFECOUNTER_FEATURE_FAULTS
+    printf(REMOTE_COMMAND " fault [off | <latency_ms> <stall_every> <stall_ms> <short_write_every> <open_fail_every> [seed]]\r\n");
+    printf("\tslow down and fail storage calls, without arguments print the faults injected so far\r\n");
+#endif
+}
+
+/**
+ * Publish the events of a complete press, the GUI delivers them to the current view.
+ */
+static void remote_inject(LifecounterRemote* remote, InputKey key, InputType type) {
+    const InputType types[] = {InputTypePress, type, InputTypeRelease};
+    remote->injected++;
+    for(size_t i = 0; i < COUNT_OF(types); i++) {
+        InputEvent event = {.sequence = remote->injected, .key = key, .type = types[i]};
+        furi_pubsub_publish(remote->input, &event);
+    }
+}
+
+static void remote_press(LifecounterRemote* remote, FuriString* args) {
+    FuriString* word = furi_string_alloc();
+    size_t k = COUNT_OF(remote_keys);
+    InputType type = InputTypeShort;
+
+    if(args_read_string_and_trim(args, word)) {
+        for(k = 0; k < COUNT_OF(remote_keys); k++) {
+            if(strcmp(furi_string_get_cstr(word), remote_keys[k].name) == 0) {
+                break;
+            }
+        }
+    }
+    if(args_read_string_and_trim(args, word) && strcmp(furi_string_get_cstr(word), "long") == 0) {
+        type = InputTypeLong;
+    }
+    furi_string_free(word);
+    if(k == COUNT_OF(remote_keys)) {
+        remote_usage();
+        return;
+    }
+
+    uint32_t expected = atomic_load(&remote->input_mark.sequence) + 1;
+    uint32_t sent = clock_cycles();
+    remote_inject(remote, remote_keys[k].key, type);
+
+    // Presses that don't change the game, or arrive while another screen is shown, never get a frame
+    uint32_t waited = 0;
+    while((int32_t)(atomic_load(&remote->frame_mark.sequence) - expected) < 0 && waited < REMOTE_WAIT_MS &&
+          !remote_closing()) {
+        furi_delay_ms(1);
+        waited++;
+    }
+    if((int32_t)(atomic_load(&remote->frame_mark.sequence) - expected) < 0) {
+        printf("press seq=%lu sent=%lu timeout\r\n", expected, sent);
+        return;
+    }
+    printf(
+        "press seq=%lu sent=%lu input=%u update=%u frame=%u\r\n",
+        expected,
+        sent,
+        atomic_load(&remote->input_mark.cycles),
+        atomic_load(&remote->update_mark.cycles),
+        atomic_load(&remote->frame_mark.cycles));
+}
+
+/**
+ * Wait until the main view has received the latest injected press.
+ */
+static bool remote_wait_input(LifecounterRemote* remote, uint32_t expected) {
+    for(uint32_t waited = 0; waited < REMOTE_WAIT_MS; waited++) {
+        if((int32_t)(atomic_load(&remote->input_mark.sequence) - expected) >= 0) {
+            return true;
+        }
+        furi_delay_ms(1);
+    }
+    return false;
+}
+
+/**
+ * Pick the next press of a soak run.
+ *
+ * @details    Life and commander damage of each player stay within one of where they started, so no
+ *             player wins or loses and the run leaves no match in the history.
+ */
+static InputKey remote_soak_key(
+    uint32_t roll,
+    const LifecounterModel* start,
+    const LifecounterModel* now,
+    InputType* type) {
+    uint8_t player = now->selected_player % LIFECOUNTER_PLAYERS;
+    *type = InputTypeShort;
+    switch(roll % 4) {
+    case 0:
+        return roll & 4 ? InputKeyLeft : InputKeyRight;
+    case 1:
+        // Ignored by formats without commander damage, the press still goes through the view
+        *type = InputTypeLong;
+        return now->commander_damage[player] > start->commander_damage[player] ? InputKeyDown : InputKeyUp;
+    default:
+        return now->life[player] > start->life[player] ? InputKeyDown : InputKeyUp;
+    }
+}
+
+/**
+ * Whether a snapshot is a state the soak presses can lead to.
+ */
+static bool remote_soak_valid(const LifecounterModel* start, const LifecounterModel* model) {
+    if(model->selected_player >= LIFECOUNTER_PLAYERS || model->format_flags != start->format_flags) {
+        return false;
+    }
+    for(size_t i = 0; i < LIFECOUNTER_PLAYERS; i++) {
+        int damage = model->commander_damage[i] - start->commander_damage[i];
+        if(model->status[i] != start->status[i] || abs(model->life[i] - start->life[i]) > 2 ||
+           damage < 0 || damage > 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Checker thread of a soak run, reads snapshots and runs timer ticks until it is stopped.
+ */
+static int32_t remote_soak_checker(void* context) {
+    LifecounterRemoteSoak* soak = context;
+    LifecounterRemote* remote = soak->remote;
+    LifecounterModel model;
+
+    while(!atomic_load(&soak->stop)) {
+        game_read_snapshot(soak->game, &model);
+        soak->reads++;
+        if(!remote_soak_valid(&soak->start, &model) && soak->invalid++ == 0) {
+            FURI_LOG_E(
+                TAG,
+                "Soak read an invalid snapshot: selected=%u life=%d,%d commander=%d,%d status=%u,%u",
+                model.selected_player,
+                model.life[0],
+                model.life[1],
+                model.commander_damage[0],
+                model.commander_damage[1],
+                model.status[0],
+                model.status[1]);
+        }
+        if(soak->reads % REMOTE_SOAK_TICK_EVERY == 0) {
+            remote->hooks.tick(remote->hooks.context);
+            soak->ticks++;
+            // Coalescing allows one redraw event in flight, more means requests pile up
+            int32_t backlog = remote->hooks.backlog(remote->hooks.context) - soak->backlog_start;
+            soak->backlog_max = MAX(soak->backlog_max, backlog);
+            soak->backlog_overruns += backlog > 1;
+            furi_delay_tick(1);
+        }
+    }
+    return 0;
+}
+
+static void remote_soak(Cli* cli, LifecounterRemote* remote, FuriString* args) {
+    int presses = REMOTE_SOAK_PRESSES;
+    if(furi_string_size(args) && (!args_read_int_and_trim(args, &presses) || presses <= 0)) {
+        remote_usage();
+        return;
+    }
+
+    LifecounterRemoteSoak soak = {.remote = remote, .game = tables_game(remote->tables)};
+    game_read_snapshot(soak.game, &soak.start);
+    for(size_t i = 0; i < LIFECOUNTER_PLAYERS; i++) {
+        if(soak.start.status[i] != PlayerStatusPlaying) {
+            printf("soak needs a game in progress, start a new game first\r\n");
+            return;
+        }
+    }
+    soak.backlog_start = remote->hooks.backlog(remote->hooks.context);
+    atomic_init(&soak.stop, false);
+    uint32_t retries = atomic_load(&soak.game->read_retries);
+    FuriThread* checker =
+        furi_thread_alloc_ex("LifecounterSoak", REMOTE_SOAK_STACK_SIZE, remote_soak_checker, &soak);
+    furi_thread_start(checker);
+
+    uint32_t random = REMOTE_SOAK_SEED;
+    uint32_t sent = 0;
+    uint32_t timeouts = 0;
+    uint32_t start = furi_get_tick();
+    LifecounterModel model;
+    // The app closing ends the run, the checker must be joined before the app is freed
+    while(sent < (uint32_t)presses && !cli_cmd_interrupt_received(cli) && !remote_closing()) {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        InputType type;
+        game_read_snapshot(soak.game, &model);
+        InputKey key = remote_soak_key(random, &soak.start, &model, &type);
+
+        uint32_t expected = atomic_load(&remote->input_mark.sequence) + 1;
+        remote_inject(remote, key, type);
+        sent++;
+        if(!remote_wait_input(remote, expected)) {
+            // The life screen isn't shown any more, the presses would go elsewhere
+            timeouts++;
+            break;
+        }
+        if(sent % REMOTE_SOAK_PROGRESS == 0) {
+            printf("soak %lu/%d\r\n", sent, presses);
+        }
+    }
+    uint32_t elapsed_ms = (uint64_t)(furi_get_tick() - start) * 1000 / furi_kernel_get_tick_frequency();
+
+    atomic_store(&soak.stop, true);
+    furi_thread_join(checker);
+    furi_thread_free(checker);
+
+    bool passed = !timeouts && !soak.invalid && !soak.backlog_overruns;
+    printf(
+        "soak presses=%lu timeouts=%lu ms=%lu reads=%lu retries=%lu ticks=%lu invalid=%lu "
+        "backlog_max=%ld backlog_overruns=%lu result=%s\r\n",
+        sent,
+        timeouts,
+        elapsed_ms,
+        soak.reads,
+        atomic_load(&soak.game->read_retries) - retries,
+        soak.ticks,
+        soak.invalid,
+        soak.backlog_max,
+        soak.backlog_overruns,
+        passed ? "ok" : "FAILED");
+}
+
+static void remote_state(LifecounterRemote* remote) {
+    LifecounterModel model;
+    game_read_snapshot(tables_game(remote->tables), &model);
+    printf(
+        "state table=%u selected=%u turn=%u,%u life=%d,%d commander=%d,%d status=%u,%u\r\n",
+        tables_active_index(remote->tables),
+        model.selected_player,
+        model.turn,
+        model.turn_player,
+        model.life[0],
+        model.life[1],
+        model.commander_damage[0],
+        model.commander_damage[1],
+        model.status[0],
+        model.status[1]);
+}
+
+static void remote_probe(LifecounterRemote* remote) {
+    printf(
+        "probe input=%u,%u update=%u,%u frame=%u,%u\r\n",
+        atomic_load(&remote->input_mark.sequence),
+        atomic_load(&remote->input_mark.cycles),
+        atomic_load(&remote->update_mark.sequence),
+        atomic_load(&remote->update_mark.cycles),
+        atomic_load(&remote->frame_mark.sequence),
+        atomic_load(&remote->frame_mark.cycles));
+}
+
+#if LIFECOUNTER_FEATURE_FAULTS
+static void remote_fault(FuriString* args) {
+    LifecounterFaultConfig config = {.seed = FAULT_SEED};
+    uint32_t* fields[] = {
+        &config.latency_ms,
+        &config.stall_every,
+        &config.stall_ms,
+        &config.short_write_every,
+        &config.open_fail_every,
+        &config.seed,
+    };
+
+    if(furi_string_cmp_str(args, "off") == 0) {
+        fault_configure(&config);
+    } else if(furi_string_size(args)) {
+        size_t read = 0;
+        int value;
+        while(read < COUNT_OF(fields) && args_read_int_and_trim(args, &value) && value >= 0) {
+            *fields[read++] = value;
+        }
+        // The seed is optional
+        if(read < COUNT_OF(fields) - 1) {
+            remote_usage();
+            return;
+        }
+        fault_configure(&config);
+    }
+
+    LifecounterFaultStats stats;
+    fault_get(&config, &stats);
+    printf(
+        "fault latency_ms=%lu stall=%lu,%lu short_write=%lu open_fail=%lu seed=%lu "
+        "operations=%lu stalls=%lu short_writes=%lu open_failures=%lu\r\n",
+        config.latency_ms,
+        config.stall_every,
+        config.stall_ms,
+        config.short_write_every,
+        config.open_fail_every,
+        config.seed,
+        stats.operations,
+        stats.stalls,
+        stats.short_writes,
+        stats.open_failures);
+}
+#endif
+
+static void remote_run_command(Cli* cli, LifecounterRemote* remote, FuriString* args) {
+    FuriString* command = furi_string_alloc();
+
+    if(!args_read_string_and_trim(args, command)) {
+        remote_usage();
+    } else if(strcmp(furi_string_get_cstr(command), "press") == 0) {
+        remote_press(remote, args);
+    } else if(strcmp(furi_string_get_cstr(command), "soak") == 0) {
+        remote_soak(cli, remote, args);
+    } else if(strcmp(furi_string_get_cstr(command), "state") == 0) {
+        remote_state(remote);
+    } else if(strcmp(furi_string_get_cstr(command), "probe") == 0) {
+        remote_probe(remote);
+    } else if(strcmp(furi_string_get_cstr(command), "info") == 0) {
+        printf("info cycles_per_us=%lu\r\n", furi_hal_cortex_instructions_per_microsecond());
+#if LIFECOUNTER_FEATURE_FAULTS
+    } else if(strcmp(furi_string_get_cstr(command), "fault") == 0) {
+        remote_fault(args);
+#endif
+    } else {
+        remote_usage();
+    }
+    furi_string_free(command);
+}
+
+/**
+ * Entry point of the CLI command, runs on the CLI thread.
+ */
+static void remote_cli_command(Cli* cli, FuriString* args, void* context) {
+    UNUSED(context);
+    // Counted before the remote is looked up, remote_deinit() clears it first and then waits for
+    // the count, so either the command sees it cleared or remote_deinit() sees the command
+    atomic_fetch_add(&remote_running, 1);
+    LifecounterRemote* remote = atomic_load(&remote_open);
+    if(remote) {
+        remote_run_command(cli, remote, args);
+    }
+    atomic_fetch_sub(&remote_running, 1);
+}
+
+void remote_init(LifecounterRemote* remote, LifecounterTables* tables, const LifecounterRemoteHooks* hooks) {
+    memset(remote, 0, sizeof(LifecounterRemote));
+    remote->tables = tables;
+    remote->hooks = *hooks;
+    remote->input = furi_record_open(RECORD_INPUT_EVENTS);
+    atomic_store(&remote_open, remote);
+
+    Cli* cli = furi_record_open(RECORD_CLI);
+    cli_add_command(cli, REMOTE_COMMAND, CliCommandFlagParallelSafe, remote_cli_command, remote);
+    furi_record_close(RECORD_CLI);
+}
+
+void remote_deinit(LifecounterRemote* remote) {
+    furi_check(atomic_exchange(&remote_open, NULL) == remote);
+    Cli* cli = furi_record_open(RECORD_CLI);
+    cli_delete_command(cli, REMOTE_COMMAND);
+    furi_record_close(RECORD_CLI);
+
+    // Deleting the command doesn't wait for a press or soak already running on the CLI thread
+    uint32_t waited = 0;
+    while(atomic_load(&remote_running) > 0) {
+        furi_delay_ms(REMOTE_CLOSE_POLL_MS);
+        waited += REMOTE_CLOSE_POLL_MS;
+    }
+    if(waited) {
+        FURI_LOG_I(TAG, "Waited %lums for CLI commands to finish", waited);
+    }
+    furi_record_close(RECORD_INPUT_EVENTS);
+}
+
+#endif
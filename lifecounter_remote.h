@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <furi.h>
+#include "lifecounter_clock.h"
+#include "lifecounter_tables.h"
+
+#define REMOTE_COMMAND "lifecounter" // CLI command, see remote_init()
+#define REMOTE_WAIT_MS 500 // How long a press waits for the frame showing its update
+#define REMOTE_SOAK_PRESSES 10000 // Presses of a soak run unless the command gives a count
+#define REMOTE_SOAK_TICK_EVERY 8 // Checker reads between the timer ticks it runs itself
+#define REMOTE_CLOSE_POLL_MS 10 // How often remote_deinit() checks for commands still running
+
+/**
+ * Cycle counter timestamp of the latest event at one stage of the input to frame path.
+ */
+typedef struct {
+    atomic_uint sequence; // Input the stage belongs to
+    atomic_uint cycles; // clock_cycles() when it happened
+} LifecounterProbeMark;
+
+/**
+ * What the soak needs from the app besides the game.
+ */
+typedef struct {
+    void (*tick)(void* context); // Do the work of one timer tick, called from another thread
+    uint32_t (*backlog)(void* context); // Redraw events sent to the dispatcher and not handled yet
+    void* context;
+} LifecounterRemoteHooks;
+
+/**
+ * CLI surface for driving the app from a host and timing it on the device.
+ *
+ * @details    The lifecounter CLI command injects key presses through the input record, so they take
+ *             the same path through the GUI as real ones, reads the game state and reports cycle
+ *             counter timestamps of the stages a press goes through: input received by the main view,
+ *             model updated and frame drawn. scripts/latency_probe.py uses it to collect latency
+ *             distributions over many presses. The marks are written from the GUI thread and read by
+ *             the CLI thread, presses are meant to be sent one at a time. A command runs on the CLI
+ *             thread and works on the app, so remote_deinit() waits until every command that has
+ *             started has returned. The CLI can start a command after it has been unregistered, the
+ *             count of running commands is therefore kept outside of the app.
+ *
+ *             The soak subcommand sends random presses as fast as the app takes them while a checker
+ *             thread reads snapshots of the game and runs timer ticks of its own, so the dispatcher,
+ *             GUI, timer, worker, CLI and checker threads all work on the app at once. The checker
+ *             reports snapshots that break the rules of the game and redraw events piling up in the
+ *             dispatcher.
+ */
+typedef struct {
+    LifecounterTables* tables; // The command works on the table shown
+    LifecounterRemoteHooks hooks;
+    FuriPubSub* input; // Input events record
+    uint32_t injected; // Presses injected, only touched by the CLI thread
+    LifecounterProbeMark input_mark; // Sequence counts the inputs that act on the game
+    LifecounterProbeMark update_mark; // Sequence of the input that caused the update
+    LifecounterProbeMark frame_mark; // Sequence of the latest update the frame shows
+    atomic_uint update_input_cycles; // Cycles of the input mark behind the latest update
+} LifecounterRemote;
+
+/**
+ * Register the CLI command.
+ *
+ * @param      remote  The remote.
+ * @param      tables  Tables whose game on show the command reports.
+ * @param      hooks   Access to the app for the soak, copied.
+ */
+void remote_init(LifecounterRemote* remote, LifecounterTables* tables, const LifecounterRemoteHooks* hooks);
+
+/**
+ * Unregister the CLI command and wait for the commands still running, so the app can be freed.
+ */
+void remote_deinit(LifecounterRemote* remote);
+
+/**
+ * Mark an input that acts on the game as received.
+ */
+static inline void remote_mark_input(LifecounterRemote* remote) {
+    atomic_store(&remote->input_mark.cycles, clock_cycles());
+    atomic_fetch_add(&remote->input_mark.sequence, 1);
+}
+
+/**
+ * Mark the game state as updated by the latest input.
+ */
+static inline void remote_mark_update(LifecounterRemote* remote) {
+    atomic_store(&remote->update_input_cycles, atomic_load(&remote->input_mark.cycles));
+    atomic_store(&remote->update_mark.cycles, clock_cycles());
+    atomic_store(&remote->update_mark.sequence, atomic_load(&remote->input_mark.sequence));
+}
+
+/**
+ * Sequence of the latest update, read before the snapshot a frame is drawn from.
+ */
+static inline uint32_t remote_frame_begin(LifecounterRemote* remote) {
+    return atomic_load(&remote->update_mark.sequence);
+}
+
+/**
+ * Mark a frame drawn from a snapshot taken after remote_frame_begin().
+ *
+ * @return     Cycles from the input behind the update to this frame if it is the first frame showing the
+ *             update, 0 otherwise.
+ */
+static inline uint32_t remote_frame_end(LifecounterRemote* remote, uint32_t sequence) {
+    uint32_t now = clock_cycles();
+    uint32_t latency = 0;
+    if(sequence != atomic_load(&remote->frame_mark.sequence)) {
+        latency = now - atomic_load(&remote->update_input_cycles);
+    }
+    atomic_store(&remote->frame_mark.cycles, now);
+    atomic_store(&remote->frame_mark.sequence, sequence);
+    return latency;
+}
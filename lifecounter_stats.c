@@ -0,0 +1,36 @@
+#include "lifecounter_features.h"
+#include "lifecounter_stats.h"
+
+#if LIFECOUNTER_FEATURE_HISTORY
+
+_Static_assert(sizeof(LifecounterMatch) == 24, "Match record layout is stored on the SD card");
+
+void stats_reset(LifecounterStats* stats) {
+    memset(stats, 0, sizeof(LifecounterStats));
+}
+
+void stats_add(LifecounterStats* stats, const LifecounterMatch* match) {
+    stats->matches++;
+    if(match->winner < LIFECOUNTER_PLAYERS) {
+        stats->wins[match->winner]++;
+    } else {
+        stats->undecided++;
+    }
+    if(match->format < FormatIdCount) {
+        stats->format_matches[match->format]++;
+    }
+    stats->events += match->events;
+    stats->total_duration_s += match->duration_s;
+    stats->longest_s = MAX(stats->longest_s, match->duration_s);
+}
+
+uint8_t stats_winner(const LifecounterModel* model) {
+    for(uint8_t i = 0; i < LIFECOUNTER_PLAYERS; i++) {
+        if(model->status[i] == PlayerStatusWon) {
+            return i;
+        }
+    }
+    return MATCH_NO_WINNER;
+}
+
+#endif
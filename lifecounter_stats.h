@@ -0,0 +1,46 @@
+#pragma once
+
+#include <furi.h>
+#include "lifecounter_game.h"
+#include "lifecounter_format.h"
+
+#define MATCH_NO_WINNER 0xFF
+
+/**
+ * Summary of a finished match as stored in the history file, one fixed size record per match.
+ */
+typedef struct {
+    uint32_t id; // Index of the record in the history file
+    uint32_t ended; // RTC timestamp of the end of the match
+    uint32_t duration_s;
+    uint32_t events; // Operations recorded in the journal
+    uint8_t format; // LifecounterFormatId
+    uint8_t winner; // Winning player or MATCH_NO_WINNER
+    int16_t starting_life;
+    int16_t final_life[LIFECOUNTER_PLAYERS];
+} LifecounterMatch;
+
+/**
+ * Aggregates over all matches in the history.
+ */
+typedef struct {
+    uint32_t matches;
+    uint32_t wins[LIFECOUNTER_PLAYERS];
+    uint32_t undecided; // Matches that ended without a winner
+    uint32_t format_matches[FormatIdCount];
+    uint32_t events;
+    uint32_t total_duration_s;
+    uint32_t longest_s;
+} LifecounterStats;
+
+void stats_reset(LifecounterStats* stats);
+
+/**
+ * Fold one match into the aggregates.
+ */
+void stats_add(LifecounterStats* stats, const LifecounterMatch* match);
+
+/**
+ * Winner of a finished game, MATCH_NO_WINNER if nobody has won.
+ */
+uint8_t stats_winner(const LifecounterModel* model);
@@ -0,0 +1,277 @@
+#include "lifecounter_features.h"
+#include "lifecounter_stress.h"
+#include "lifecounter_clock.h"
+#include "lifecounter_history.h"
+#include "lifecounter_fault.h"
+
+#if LIFECOUNTER_FEATURE_HISTORY && LIFECOUNTER_FEATURE_DIAGNOSTICS
+
+#define TAG "Lifecounter"
+#define STRESS_DIR APP_DATA_PATH("stress/")
+#define STRESS_STACK_SIZE 2048
+#define STRESS_SEED 0x2545F491UL
+
+/**
+ * State of a run, allocated by the worker for the duration of the run.
+ */
+typedef struct {
+    LifecounterJournal journal;
+    LifecounterHistory history;
+    LifecounterGame game;
+    LifecounterTurns turns; // Turn totals of the game
+    LifecounterGame restored; // The game as resumed from the journal
+    LifecounterTurns restored_turns; // The turn totals as resumed from the journal
+    LifecounterFormat formats[FormatIdCount];
+    LifecounterStats rebuilt;
+    uint32_t random;
+} LifecounterStressRun;
+
+/**
+ * xorshift32, so every run plays the same games.
+ */
+static uint32_t stress_random(LifecounterStressRun* run) {
+    uint32_t x = run->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    run->random = x;
+    return x;
+}
+
+/**
+ * Play one random match until somebody wins or it runs out of events.
+ */
+static void stress_play_match(LifecounterStressRun* run) {
+    uint8_t format_id = stress_random(run) % FormatIdCount;
+    const LifecounterFormat* format = &run->formats[format_id];
+    game_new(&run->game, format, game_starting_life(format, 20));
+    const LifecounterModel* live = game_live(&run->game);
+    journal_start(&run->journal, format_id, live);
+    turns_reset(&run->turns);
+
+    uint32_t events = 1 + stress_random(run) % STRESS_MAX_EVENTS;
+    for(uint32_t i = 0; i < events && stats_winner(live) == MATCH_NO_WINNER; i++) {
+        uint32_t roll = stress_random(run) % 16;
+        GameOp op;
+        if(roll < 2) {
+            op = (GameOp){.type = GameOpSelectNext};
+        } else if(roll < 3) {
+            op = (GameOp){.type = GameOpNextTurn};
+        } else if(roll < 4) {
+            op = (GameOp){.type = GameOpAdjustCommanderDamage, .value = 1};
+        } else {
+            // Lose a little more often than gain so games come to an end
+            op = (GameOp){.type = GameOpAdjustLife, .value = roll < 11 ? -1 : 1};
+        }
+        LifecounterModel before = *live;
+        if(game_apply(&run->game, &op)) {
+            turns_apply(&run->turns, &before, live);
+            journal_append(&run->journal, &op, before.selected_player, live, &run->turns);
+        }
+    }
+}
+
+static void stress_replay_event(const LifecounterJournalEvent* event, void* context) {
+    LifecounterStressRun* run = context;
+    GameOp op = {.type = event->type, .value = event->value};
+    LifecounterModel before = *game_live(&run->restored);
+    if(game_apply(&run->restored, &op)) {
+        turns_apply(&run->restored_turns, &before, game_live(&run->restored));
+    }
+}
+
+/**
+ * Resume the match just played from its journal the way the app does at startup and check that the
+ * same game and turn totals come back. The longest match is also replayed from its start for comparison.
+ */
+static void stress_check_resume(LifecounterStressResult* result, LifecounterStressRun* run) {
+    LifecounterJournalCheckpoint checkpoint;
+    uint32_t tail;
+    uint32_t events = run->journal.events;
+    journal_sync(&run->journal, game_live(&run->game), &run->turns);
+
+    uint32_t start = clock_cycles();
+    bool resumed = journal_resume(&run->journal, &checkpoint, &tail);
+    if(resumed) {
+        game_restore(&run->restored, &run->formats[checkpoint.format_id], &checkpoint.model);
+        run->restored_turns = checkpoint.turns;
+        journal_replay(&run->journal, tail, stress_replay_event, run);
+        journal_resume_finish(&run->journal, game_live(&run->restored), &run->restored_turns);
+    }
+    result->resume_us = MAX(result->resume_us, clock_elapsed_us(start));
+
+    if(!resumed || run->journal.events != events ||
+       !game_model_equal(game_live(&run->restored), game_live(&run->game)) ||
+       memcmp(&run->restored_turns, &run->turns, sizeof(LifecounterTurns)) != 0) {
+        result->resume_mismatches++;
+        return;
+    }
+
+    if(events > result->longest_events) {
+        start = clock_cycles();
+        if(journal_read_checkpoint(&run->journal, JOURNAL_FIRST_CHECKPOINT, &checkpoint)) {
+            game_restore(&run->restored, &run->formats[checkpoint.format_id], &checkpoint.model);
+            turns_reset(&run->restored_turns);
+            journal_replay(
+                &run->journal,
+                JOURNAL_FIRST_CHECKPOINT + JOURNAL_CHECKPOINT_RECORDS,
+                stress_replay_event,
+                run);
+        }
+        result->full_replay_us = clock_elapsed_us(start);
+        result->longest_events = events;
+    }
+}
+
+static void stress_measure(LifecounterStress* stress, LifecounterStressRun* run) {
+    LifecounterStressResult* result = &stress->result;
+    LifecounterMatch match;
+
+    uint32_t start = clock_cycles();
+    for(size_t i = 0; i < STRESS_LOOKUPS; i++) {
+        history_read(&run->history, stress_random(run) % run->history.count, &match);
+    }
+    result->lookup_us = clock_elapsed_us(start) / STRESS_LOOKUPS;
+
+    start = furi_get_tick();
+    history_rebuild_stats(&run->history, &run->rebuilt);
+    result->rebuild_ms = (furi_get_tick() - start) * 1000 / furi_kernel_get_tick_frequency();
+
+    FileInfo info;
+    if(storage_common_stat(stress->storage, run->history.path, &info) == FSE_OK) {
+        result->history_bytes = info.size;
+    }
+    // Archived journals are whole records, no need to walk the directory
+    result->journal_bytes = result->events * sizeof(LifecounterJournalEvent);
+}
+
+static int32_t stress_worker(void* context) {
+    LifecounterStress* stress = context;
+    LifecounterStressResult* result = &stress->result;
+    LifecounterStressRun* run = malloc(sizeof(LifecounterStressRun));
+    memset(result, 0, sizeof(LifecounterStressResult));
+    run->random = STRESS_SEED;
+
+    storage_simply_remove_recursive(stress->storage, STRESS_DIR);
+    storage_simply_mkdir(stress->storage, STRESS_DIR);
+    journal_init(&run->journal, stress->storage, STRESS_DIR, JOURNAL_FILENAME);
+    history_init(&run->history, stress->storage, STRESS_DIR);
+    File* file = storage_file_alloc(stress->storage);
+    for(size_t i = 0; i < FormatIdCount; i++) {
+        format_load(stress->storage, file, i, &run->formats[i]);
+    }
+    storage_file_free(file);
+    memset(&run->game, 0, sizeof(LifecounterGame));
+    memset(&run->restored, 0, sizeof(LifecounterGame));
+
+    uint32_t elapsed = 0;
+    for(uint32_t i = 0; i < STRESS_MATCHES && !atomic_load(&stress->cancel); i++) {
+        uint32_t start = furi_get_tick();
+#if LIFECOUNTER_FEATURE_FAULTS
+        // Every other match is journaled on a card that cuts writes short, the journal has to
+        // recover from the failed flushes for the resume check below to pass
+        LifecounterFaultConfig faults;
+        LifecounterFaultStats before, after;
+        fault_get(&faults, &before);
+        fault_set_short_writes(i % 2 ? STRESS_SHORT_WRITE_EVERY : faults.short_write_every);
+        stress_play_match(run);
+        fault_set_short_writes(faults.short_write_every);
+        fault_get(NULL, &after);
+        result->short_writes += after.short_writes - before.short_writes;
+#else
+        stress_play_match(run);
+#endif
+        elapsed += furi_get_tick() - start;
+
+        stress_check_resume(result, run);
+
+        start = furi_get_tick();
+        uint32_t events = run->journal.events;
+        if(history_finish_game(&run->history, &run->journal, game_live(&run->game), NULL)) {
+            result->matches++;
+            result->events += events;
+        }
+        elapsed += furi_get_tick() - start;
+        atomic_store(&stress->progress, i + 1);
+        if(stress->callback) {
+            stress->callback(stress->context);
+        }
+    }
+    result->elapsed_ms = (uint64_t)elapsed * 1000 / furi_kernel_get_tick_frequency();
+    result->events_per_s = result->elapsed_ms ? (uint64_t)result->events * 1000 / result->elapsed_ms : 0;
+
+    bool passed = !atomic_load(&stress->cancel) && result->matches > 0;
+    if(passed) {
+        stress_measure(stress, run);
+        // The aggregates kept while appending must match a rebuild from the records
+        passed = memcmp(&run->rebuilt, &run->history.stats, sizeof(LifecounterStats)) == 0 &&
+                 result->resume_mismatches == 0;
+        FURI_LOG_I(
+            TAG,
+            "stress matches=%lu events=%lu ms=%lu events_per_s=%lu journal_bytes=%lu "
+            "history_bytes=%lu lookup_us=%lu rebuild_ms=%lu resume_us=%lu longest_events=%lu "
+            "full_replay_us=%lu resume_mismatches=%lu short_writes=%lu stats=%s",
+            result->matches,
+            result->events,
+            result->elapsed_ms,
+            result->events_per_s,
+            result->journal_bytes,
+            result->history_bytes,
+            result->lookup_us,
+            result->rebuild_ms,
+            result->resume_us,
+            result->longest_events,
+            result->full_replay_us,
+            result->resume_mismatches,
+            result->short_writes,
+            passed ? "ok" : "MISMATCH");
+    }
+
+    history_deinit(&run->history);
+    journal_deinit(&run->journal);
+    storage_simply_remove_recursive(stress->storage, STRESS_DIR);
+    free(run);
+
+    atomic_store(&stress->state, passed ? StressStateDone : StressStateFailed);
+    if(stress->callback) {
+        stress->callback(stress->context);
+    }
+    return 0;
+}
+
+void stress_init(LifecounterStress* stress, Storage* storage, LifecounterStressCallback callback, void* context) {
+    stress->storage = storage;
+    stress->callback = callback;
+    stress->context = context;
+    stress->thread = furi_thread_alloc_ex("LifecounterStress", STRESS_STACK_SIZE, stress_worker, stress);
+    atomic_init(&stress->state, StressStateIdle);
+    atomic_init(&stress->progress, 0);
+    atomic_init(&stress->cancel, false);
+}
+
+void stress_deinit(LifecounterStress* stress) {
+    atomic_store(&stress->cancel, true);
+    if(atomic_load(&stress->state) != StressStateIdle) {
+        furi_thread_join(stress->thread);
+    }
+    furi_thread_free(stress->thread);
+}
+
+bool stress_start(LifecounterStress* stress) {
+    unsigned int state = atomic_load(&stress->state);
+    if(state == StressStateRunning) {
+        return false;
+    }
+    if(state != StressStateIdle) {
+        // Reap the previous run before the thread is started again
+        furi_thread_join(stress->thread);
+    }
+
+    atomic_store(&stress->progress, 0);
+    atomic_store(&stress->cancel, false);
+    atomic_store(&stress->state, StressStateRunning);
+    furi_thread_start(stress->thread);
+    return true;
+}
+
+#endif
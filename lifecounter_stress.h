@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <furi.h>
+#include <storage/storage.h>
+
+#define STRESS_MATCHES 200 // Matches simulated per run
+#define STRESS_MAX_EVENTS 500 // Events of the longest simulated match
+#define STRESS_LOOKUPS 256 // Random history lookups timed per run
+#define STRESS_SHORT_WRITE_EVERY 8 // Writes cut short while every other match is played, with the faults built in
+
+typedef enum {
+    StressStateIdle,
+    StressStateRunning,
+    StressStateDone,
+    StressStateFailed,
+} LifecounterStressState;
+
+typedef struct {
+    uint32_t matches; // Matches recorded
+    uint32_t events; // Journal events appended
+    uint32_t elapsed_ms; // Time spent playing, journaling and recording the matches
+    uint32_t events_per_s;
+    uint32_t journal_bytes; // Size of all archived journals
+    uint32_t history_bytes; // Size of the history file
+    uint32_t lookup_us; // Average time to read a random match
+    uint32_t rebuild_ms; // Time to rebuild the aggregates from the history file
+    uint32_t resume_us; // Slowest resume of a match from its latest checkpoint
+    uint32_t longest_events; // Operations of the longest match
+    uint32_t full_replay_us; // Time to replay the longest match from its start
+    uint32_t resume_mismatches; // Resumed matches that differ from the played ones
+    uint32_t short_writes; // Journal writes cut short on purpose, their matches must resume all the same
+} LifecounterStressResult;
+
+typedef void (*LifecounterStressCallback)(void* context);
+
+/**
+ * Simulates a season of tournaments through the journal, history and statistics code.
+ *
+ * @details    Random games are played with the game engine in a worker thread and recorded into a
+ *             scratch directory on the SD card, which is removed again after the run. The result
+ *             tells how the persistence layer scales on real hardware.
+ */
+typedef struct {
+    Storage* storage;
+    FuriThread* thread;
+    LifecounterStressCallback callback; // Called from the worker on progress, keep it short
+    void* context;
+    atomic_uint state; // LifecounterStressState
+    atomic_uint progress; // Matches simulated in the current run
+    atomic_bool cancel;
+    LifecounterStressResult result; // Valid once the state is StressStateDone
+} LifecounterStress;
+
+void stress_init(LifecounterStress* stress, Storage* storage, LifecounterStressCallback callback, void* context);
+
+/**
+ * Cancel a running simulation and wait for it to stop.
+ */
+void stress_deinit(LifecounterStress* stress);
+
+/**
+ * Start a simulation unless one is running.
+ *
+ * @return     true if a simulation was started.
+ */
+bool stress_start(LifecounterStress* stress);
@@ -0,0 +1,57 @@
+#include "lifecounter_tables.h"
+
+#define TAG "Lifecounter"
+
+/**
+ * Name of a file of a table, base.bin for the first table and base<n>.bin for the others.
+ */
+static void tables_file_name(char* name, size_t size, const char* base, size_t index) {
+    if(index == 0) {
+        snprintf(name, size, "%s.bin", base);
+    } else {
+        snprintf(name, size, "%s%zu.bin", base, index + 1);
+    }
+}
+
+void tables_init(LifecounterTables* tables, Storage* storage, const char* dir) {
+    memset(tables, 0, sizeof(LifecounterTables));
+    atomic_init(&tables->active, 0);
+    tables->dir = dir;
+#if LIFECOUNTER_FEATURE_HISTORY
+    char name[TABLES_NAME_SIZE];
+    for(size_t i = 0; i < TABLES_COUNT; i++) {
+        // The first table keeps the journal of versions with a single game, journal.bin
+        tables_file_name(name, sizeof(name), "journal", i);
+        journal_init(&tables->slots[i].journal, storage, dir, name);
+    }
+#else
+    UNUSED(storage);
+#endif
+    FURI_LOG_I(TAG, "Tables %d x %zu bytes", TABLES_COUNT, sizeof(LifecounterTable));
+}
+
+void tables_path(LifecounterTables* tables, uint8_t index, const char* base, char* path, size_t size) {
+    char name[TABLES_NAME_SIZE];
+    tables_file_name(name, sizeof(name), base, index);
+    snprintf(path, size, "%s%s", tables->dir, name);
+}
+
+void tables_deinit(LifecounterTables* tables) {
+#if LIFECOUNTER_FEATURE_HISTORY
+    for(size_t i = 0; i < TABLES_COUNT; i++) {
+        LifecounterTable* table = &tables->slots[i];
+        journal_sync(&table->journal, game_live(&table->game), &table->turns);
+        journal_deinit(&table->journal);
+    }
+#else
+    UNUSED(tables);
+#endif
+}
+
+uint8_t tables_switch(LifecounterTables* tables, uint8_t index) {
+    if(index >= TABLES_COUNT) {
+        index = 0;
+    }
+    atomic_store(&tables->active, index);
+    return index;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <furi.h>
+#include <storage/storage.h>
+#include "lifecounter_features.h"
+#include "lifecounter_game.h"
+#include "lifecounter_journal.h"
+#include "lifecounter_turns.h"
+
+#define TABLES_COUNT 4 // Games tracked at once, each in a fixed slot
+#define TABLES_NAME_SIZE 16
+#define TABLES_GRAPH_NAME "graph" // Saved graph of a table, graph.bin for the first table, graph<n>.bin for the others
+
+/**
+ * The game of one table.
+ */
+typedef struct {
+    LifecounterGame game;
+    LifecounterTurns turns; // Running totals of the turns of the game
+#if LIFECOUNTER_FEATURE_HISTORY
+    LifecounterJournal journal; // Journal of the game, journal.bin for the first table, journal<n>.bin for the others
+#endif
+} LifecounterTable;
+
+/**
+ * Fixed slots for the games of several tables, one of which is shown.
+ *
+ * @details    Every table keeps its game and journal in RAM for the lifetime of the app, so switching
+ *             only changes the active index and no file is read. The memory taken is
+ *             TABLES_COUNT * sizeof(LifecounterTable) whatever the number of tables in use. A table
+ *             that isn't shown has nothing pending in its journal, the main view flushes it when it
+ *             is left and tables are switched from the menu. The slots are only touched by the
+ *             dispatcher thread, the active index is atomic so the draw callback and the CLI follow
+ *             a switch.
+ */
+typedef struct {
+    LifecounterTable slots[TABLES_COUNT];
+    atomic_uint active; // Index of the table shown
+    const char* dir; // Directory for the files of the tables, ends with a slash
+} LifecounterTables;
+
+/**
+ * Set up the slots, the games are set up by the caller.
+ *
+ * @param      tables   The tables.
+ * @param      storage  Storage record.
+ * @param      dir      Directory for the journals, ends with a slash. Must outlive the tables.
+ */
+void tables_init(LifecounterTables* tables, Storage* storage, const char* dir);
+
+/**
+ * Path of a file a table keeps next to its journal.
+ *
+ * @param      tables  The tables.
+ * @param      index   Index of the table.
+ * @param      base    Name of the file of the first table without extension, the others add their number.
+ * @param      path    Filled with the path.
+ * @param      size    Size of path.
+ */
+void tables_path(LifecounterTables* tables, uint8_t index, const char* base, char* path, size_t size);
+
+/**
+ * Write out the journals and release their file handles.
+ */
+void tables_deinit(LifecounterTables* tables);
+
+/**
+ * Show another table.
+ *
+ * @return     The index of the table shown now.
+ */
+uint8_t tables_switch(LifecounterTables* tables, uint8_t index);
+
+static inline uint8_t tables_active_index(LifecounterTables* tables) {
+    return atomic_load(&tables->active);
+}
+
+static inline LifecounterTable* tables_active(LifecounterTables* tables) {
+    return &tables->slots[atomic_load(&tables->active)];
+}
+
+/**
+ * Game of the table shown, safe to call from any thread.
+ */
+static inline LifecounterGame* tables_game(LifecounterTables* tables) {
+    return &tables->slots[atomic_load(&tables->active)].game;
+}
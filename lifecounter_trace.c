@@ -0,0 +1,253 @@
+#include "lifecounter_trace.h"
+#include "lifecounter_energy.h"
+#include "lifecounter_watchdog.h"
+#include "lifecounter_histogram.h"
+#include <stdarg.h>
+
+#if LIFECOUNTER_FEATURE_TRACE
+
+#define TAG "Lifecounter"
+
+_Static_assert((TRACE_RECORDS & (TRACE_RECORDS - 1)) == 0, "The ring index is masked");
+
+static const struct {
+    const char* name;
+    const char* category; // Context the point runs in
+    bool storage; // Storage operation, timed by the storage histogram
+} trace_points[TracePointCount] = {
+    [TracePointMainDraw] = {"main_draw", "gui", false},
+    [TracePointMainInput] = {"main_input", "gui", false},
+    [TracePointMainTimer] = {"main_timer", "timer", false},
+    [TracePointMainRedraw] = {"main_redraw", "dispatcher", false},
+    [TracePointSubmenu] = {"submenu", "dispatcher", false},
+    [TracePointWriteConfig] = {"write_config", "storage", true},
+    [TracePointReadConfig] = {"read_config", "storage", true},
+    [TracePointBeep] = {"beep", "dispatcher", false},
+    [TracePointWorkerStep] = {"worker_step", "storage", true},
+    [TracePointJournalFlush] = {"journal_flush", "storage", true},
+};
+
+static LifecounterTraceRecord trace_ring[TRACE_RECORDS];
+static atomic_uint trace_head; // Records claimed since startup
+
+void trace_end(LifecounterTracePoint point, uint32_t start) {
+    uint32_t end = clock_cycles();
+    uint32_t index = atomic_fetch_add_explicit(&trace_head, 1, memory_order_relaxed);
+    LifecounterTraceRecord* record = &trace_ring[index & (TRACE_RECORDS - 1)];
+
+    atomic_store_explicit(&record->sequence, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    record->start = start;
+    record->cycles = end - start;
+    record->thread = (uint32_t)(uintptr_t)furi_thread_get_current_id();
+    record->point = point;
+    atomic_store_explicit(&record->sequence, index + 1, memory_order_release);
+
+    watchdog_span(point, end - start);
+    if(trace_points[point].storage) {
+        histogram_record_cycles(HistogramStorage, end - start);
+    }
+}
+
+const char* trace_point_name(LifecounterTracePoint point) {
+    return point < TracePointCount ? trace_points[point].name : "?";
+}
+
+uint32_t trace_count(void) {
+    return atomic_load_explicit(&trace_head, memory_order_relaxed);
+}
+
+/**
+ * Copy a record out of the ring.
+ *
+ * @return     true if the record is complete and wasn't overwritten while it was copied.
+ */
+static bool trace_read(uint32_t index, LifecounterTraceRecord* copy) {
+    LifecounterTraceRecord* record = &trace_ring[index & (TRACE_RECORDS - 1)];
+    if(atomic_load_explicit(&record->sequence, memory_order_acquire) != index + 1) {
+        return false;
+    }
+    copy->start = record->start;
+    copy->cycles = record->cycles;
+    copy->thread = record->thread;
+    copy->point = record->point;
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&record->sequence, memory_order_relaxed) == index + 1;
+}
+
+static void trace_flush(LifecounterTraceWriter* writer) {
+    size_t written = storage_file_write(writer->file, writer->buffer, writer->length);
+    energy_count_sd_written(written);
+    writer->written += written;
+    writer->failed |= written != writer->length;
+    writer->length = 0;
+}
+
+/**
+ * Append formatted text to the output buffer, flushing it first when the text doesn't fit.
+ */
+static void trace_printf(LifecounterTraceWriter* writer, const char* format, ...) {
+    for(int attempt = 0; attempt < 2 && !writer->failed; attempt++) {
+        size_t space = sizeof(writer->buffer) - writer->length;
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(writer->buffer + writer->length, space, format, args);
+        va_end(args);
+        if(length >= 0 && (size_t)length < space) {
+            writer->length += length;
+            return;
+        }
+        trace_flush(writer);
+    }
+    writer->failed = true;
+}
+
+/**
+ * Take the records in the ring, open the file and start the JSON.
+ */
+static bool trace_dump_open(LifecounterTraceDump* dump) {
+    LifecounterTraceRecord record;
+    uint32_t end = trace_count();
+    uint32_t first = end > TRACE_RECORDS ? end - TRACE_RECORDS : 0;
+    bool have_base = false;
+
+    // The ring is in order of end time, a span enclosing an older one starts before it, so the
+    // earliest start is searched for rather than taken from the oldest record
+    dump->base = 0;
+    for(uint32_t index = first; index != end; index++) {
+        if(trace_read(index, &record) && (!have_base || (int32_t)(record.start - dump->base) < 0)) {
+            dump->base = record.start;
+            have_base = true;
+        }
+    }
+
+    if(!storage_file_open(dump->writer.file, dump->path, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        storage_file_close(dump->writer.file);
+        FURI_LOG_E(TAG, "Failed to open file: %s", dump->path);
+        return false;
+    }
+
+    dump->opened = true;
+    dump->next = first;
+    dump->end = end;
+    dump->events = 0;
+    trace_printf(&dump->writer, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    return true;
+}
+
+/**
+ * Format the next batch of records.
+ */
+static void trace_dump_records(LifecounterTraceDump* dump) {
+    LifecounterTraceRecord record;
+    uint32_t cycles_per_us = furi_hal_cortex_instructions_per_microsecond();
+    uint32_t stop = dump->next + MIN(dump->end - dump->next, (uint32_t)TRACE_DUMP_BATCH);
+
+    for(; dump->next != stop && !dump->writer.failed; dump->next++) {
+        if(!trace_read(dump->next, &record)) {
+            continue;
+        }
+        // Timestamps are relative to the earliest span, which keeps them clear of the counter wrap.
+        // A span recorded while dumping may start earlier still, it is put at the start.
+        uint32_t start = (int32_t)(record.start - dump->base) > 0 ? record.start - dump->base : 0;
+        trace_printf(
+            &dump->writer,
+            "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%lu.%03lu,\"dur\":%lu.%03lu}",
+            dump->events ? "," : "",
+            trace_points[record.point].name,
+            trace_points[record.point].category,
+            record.thread,
+            start / cycles_per_us,
+            start % cycles_per_us * 1000 / cycles_per_us,
+            record.cycles / cycles_per_us,
+            record.cycles % cycles_per_us * 1000 / cycles_per_us);
+        dump->events++;
+    }
+}
+
+/**
+ * End the dump, removing the partial file unless it completed.
+ */
+static void trace_dump_finish(LifecounterTraceDump* dump, bool complete) {
+    if(complete) {
+        trace_printf(&dump->writer, "\n]}\n");
+        trace_flush(&dump->writer);
+    }
+    storage_file_close(dump->writer.file);
+    dump->opened = false;
+
+    complete &= !dump->writer.failed;
+    FURI_LOG_I(TAG, "trace events=%lu bytes=%zu", dump->events, dump->writer.written);
+    if(!complete) {
+        storage_simply_remove(dump->storage, dump->path);
+    }
+    dump->bytes = complete ? dump->writer.written : 0;
+    atomic_store(&dump->state, complete ? TraceDumpStateDone : TraceDumpStateFailed);
+}
+
+/**
+ * Open the file or write one batch of records, run by the worker.
+ */
+static bool trace_dump_step(void* context) {
+    LifecounterTraceDump* dump = context;
+
+    if(!dump->opened) {
+        if(!trace_dump_open(dump)) {
+            dump->bytes = 0;
+            atomic_store(&dump->state, TraceDumpStateFailed);
+        }
+    } else {
+        trace_dump_records(dump);
+        if(dump->next == dump->end || dump->writer.failed) {
+            trace_dump_finish(dump, true);
+        }
+    }
+
+    if(dump->callback) {
+        dump->callback(dump->context);
+    }
+    return atomic_load(&dump->state) == TraceDumpStateRunning;
+}
+
+void trace_dump_init(
+    LifecounterTraceDump* dump,
+    Storage* storage,
+    const char* path,
+    LifecounterTraceDumpCallback callback,
+    void* context) {
+    memset(dump, 0, sizeof(LifecounterTraceDump));
+    dump->storage = storage;
+    dump->writer.file = storage_file_alloc(storage);
+    dump->path = path;
+    dump->callback = callback;
+    dump->context = context;
+    atomic_init(&dump->state, TraceDumpStateIdle);
+}
+
+void trace_dump_deinit(LifecounterTraceDump* dump) {
+    if(dump->opened) {
+        // The worker stopped in the middle of the dump
+        trace_dump_finish(dump, false);
+    }
+    storage_file_free(dump->writer.file);
+}
+
+bool trace_dump_start(LifecounterTraceDump* dump, LifecounterWorker* worker) {
+    if(atomic_load(&dump->state) == TraceDumpStateRunning) {
+        return false;
+    }
+
+    dump->writer.length = 0;
+    dump->writer.written = 0;
+    dump->writer.failed = false;
+    dump->opened = false;
+    atomic_store(&dump->state, TraceDumpStateRunning);
+    if(!worker_post(worker, trace_dump_step, dump)) {
+        dump->bytes = 0;
+        atomic_store(&dump->state, TraceDumpStateFailed);
+        return false;
+    }
+    return true;
+}
+
+#endif
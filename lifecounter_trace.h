@@ -0,0 +1,151 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <furi.h>
+#include <storage/storage.h>
+#include "lifecounter_features.h"
+#include "lifecounter_clock.h"
+#include "lifecounter_worker.h"
+
+#define TRACE_RECORDS 256 // Records kept in the ring, a power of two
+#define TRACE_BUFFER_SIZE 256 // Output buffer of the JSON dump
+#define TRACE_DUMP_BATCH 32 // Records formatted per worker step of the dump
+
+/**
+ * Places in the code whose duration is traced.
+ */
+typedef enum {
+    TracePointMainDraw,
+    TracePointMainInput,
+    TracePointMainTimer,
+    TracePointMainRedraw,
+    TracePointSubmenu,
+    TracePointWriteConfig,
+    TracePointReadConfig,
+    TracePointBeep,
+    TracePointWorkerStep,
+    TracePointJournalFlush,
+    TracePointCount,
+} LifecounterTracePoint;
+
+/**
+ * One traced span as kept in the ring.
+ */
+typedef struct {
+    atomic_uint sequence; // Index of the record plus one once it is complete, 0 while it is written
+    uint32_t start; // clock_cycles() when the span started
+    uint32_t cycles; // Length of the span
+    uint32_t thread; // Thread the span ran on
+    uint8_t point; // LifecounterTracePoint
+} LifecounterTraceRecord;
+
+#if LIFECOUNTER_FEATURE_TRACE
+
+/**
+ * Timestamp the start of a traced span.
+ */
+static inline uint32_t trace_begin(void) {
+    return clock_cycles();
+}
+
+/**
+ * Record a span that started at trace_begin().
+ *
+ * @details    Claims the next slot of the ring with a single atomic add and fills it in place, safe to
+ *             call from any thread and never blocks. The oldest records are overwritten. The span is
+ *             also checked by the stall watchdog, and spans of storage operations go into their
+ *             latency histogram.
+ */
+void trace_end(LifecounterTracePoint point, uint32_t start);
+
+/**
+ * Name of a trace point as used in the dump.
+ */
+const char* trace_point_name(LifecounterTracePoint point);
+
+/**
+ * Number of spans recorded since startup.
+ */
+uint32_t trace_count(void);
+
+typedef enum {
+    TraceDumpStateIdle,
+    TraceDumpStateRunning,
+    TraceDumpStateDone,
+    TraceDumpStateFailed,
+} LifecounterTraceDumpState;
+
+/**
+ * Called from the worker after every step of a dump, for example to redraw its progress.
+ */
+typedef void (*LifecounterTraceDumpCallback)(void* context);
+
+/**
+ * Buffered output of the JSON dump.
+ */
+typedef struct {
+    File* file;
+    char buffer[TRACE_BUFFER_SIZE];
+    size_t length; // Bytes in the buffer
+    size_t written; // Bytes written to the card
+    bool failed;
+} LifecounterTraceWriter;
+
+/**
+ * Writes the spans in the ring to a file in the Chrome trace event format.
+ *
+ * @details    Open the file in chrome://tracing or https://ui.perfetto.dev. Each thread shows up as its
+ *             own track. Run as a worker job so the card is never written from the dispatcher thread,
+ *             each step formats one batch of records. The records in the ring when the first step
+ *             runs are written, spans still being written or overwritten before their batch is reached
+ *             are left out. A failed dump removes its partial file.
+ */
+typedef struct {
+    Storage* storage;
+    const char* path; // File written
+    LifecounterTraceDumpCallback callback;
+    void* context;
+    LifecounterTraceWriter writer;
+    bool opened; // The file is open and the records to write are known
+    uint32_t next; // Next record to write
+    uint32_t end; // Record after the last one to write
+    uint32_t base; // Earliest start of the records, timestamps are relative to it
+    uint32_t events; // Records written
+    size_t bytes; // Size of the last saved trace, set before the state changes to done
+    atomic_uint state; // LifecounterTraceDumpState
+} LifecounterTraceDump;
+
+/**
+ * Set up a trace dump.
+ *
+ * @param      dump      The dump.
+ * @param      storage   Storage record.
+ * @param      path      File to create, must outlive the dump.
+ * @param      callback  Called after every step, may be NULL.
+ * @param      context   Context for the callback.
+ */
+void trace_dump_init(
+    LifecounterTraceDump* dump,
+    Storage* storage,
+    const char* path,
+    LifecounterTraceDumpCallback callback,
+    void* context);
+
+/**
+ * Release the dump, the worker must have been stopped.
+ */
+void trace_dump_deinit(LifecounterTraceDump* dump);
+
+/**
+ * Queue a dump of the ring unless one is already running.
+ *
+ * @return     true if the dump was queued.
+ */
+bool trace_dump_start(LifecounterTraceDump* dump, LifecounterWorker* worker);
+
+#else
+
+#define trace_begin() 0
+#define trace_end(point, start) UNUSED(start)
+
+#endif
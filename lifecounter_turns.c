@@ -0,0 +1,45 @@
+#include "lifecounter_turns.h"
+
+_Static_assert(sizeof(LifecounterTurnRecord) == 32, "Turn record layout is stored on the SD card");
+
+void turns_reset(LifecounterTurns* turns) {
+    memset(turns, 0, sizeof(LifecounterTurns));
+}
+
+void turns_apply(LifecounterTurns* turns, const LifecounterModel* before, const LifecounterModel* after) {
+    if(after->turn != before->turn) {
+        for(size_t p = 0; p < LIFECOUNTER_PLAYERS; p++) {
+            turns->worst_turn[p] = MAX(turns->worst_turn[p], turns->turn[p].damage);
+            turns->turn[p] = (LifecounterTurnTotals){0};
+        }
+    }
+
+    for(size_t p = 0; p < LIFECOUNTER_PLAYERS; p++) {
+        int change = after->life[p] - before->life[p];
+        if(change < 0) {
+            turns->turn[p].damage += -change;
+            turns->game[p].damage += -change;
+        } else {
+            turns->turn[p].gained += change;
+            turns->game[p].gained += change;
+        }
+    }
+}
+
+uint32_t turns_worst(const LifecounterTurns* turns, size_t player) {
+    return MAX(turns->worst_turn[player], turns->turn[player].damage);
+}
+
+void turns_record(
+    const LifecounterTurns* turns,
+    const LifecounterModel* model,
+    uint32_t id,
+    LifecounterTurnRecord* record) {
+    memset(record, 0, sizeof(LifecounterTurnRecord));
+    record->id = id;
+    record->turns = model->turn;
+    for(size_t p = 0; p < LIFECOUNTER_PLAYERS; p++) {
+        record->game[p] = turns->game[p];
+        record->worst_turn[p] = turns_worst(turns, p);
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <furi.h>
+#include "lifecounter_game.h"
+
+/**
+ * Life a player lost and gained over a stretch of the game.
+ *
+ * @details    The counter only sees life totals change, not who made them change. With two players
+ *             the life one of them lost is the damage dealt by the other, self-inflicted life loss
+ *             included, so the damage dealt by a player is read from the totals of the opponent.
+ */
+typedef struct {
+    uint32_t damage; // Life lost, commander damage included
+    uint32_t gained; // Life gained
+} LifecounterTurnTotals;
+
+/**
+ * Running aggregates of the turns of a game.
+ *
+ * @details    Each operation adds the change of every life total to the totals of the current turn
+ *             and of the game, and passing the turn folds the current turn into the worst turn
+ *             before starting it again, so every update is O(1) whatever the length of the game and
+ *             the history is never scanned. Owned by the dispatcher thread, like the game of the
+ *             table. The turn number and the player whose turn it is are part of the game itself.
+ *             Stored in journal checkpoints, so a resumed game gets its totals back with its state.
+ */
+typedef struct {
+    LifecounterTurnTotals turn[LIFECOUNTER_PLAYERS]; // Changes since the current turn started
+    LifecounterTurnTotals game[LIFECOUNTER_PLAYERS]; // Changes since the game started
+    uint32_t worst_turn[LIFECOUNTER_PLAYERS]; // Most life lost in one of the turns before the current one
+} LifecounterTurns;
+
+/**
+ * Turn summary of a finished match as stored next to the history file, one fixed size record per match.
+ */
+typedef struct {
+    uint32_t id; // Id of the match, the record is at the same index as the match
+    uint16_t turns; // Turns played, player 1 took the first
+    uint8_t reserved[2];
+    LifecounterTurnTotals game[LIFECOUNTER_PLAYERS];
+    uint32_t worst_turn[LIFECOUNTER_PLAYERS];
+} LifecounterTurnRecord;
+
+/**
+ * Start the totals of a new game.
+ */
+void turns_reset(LifecounterTurns* turns);
+
+/**
+ * Account for one operation that changed the game.
+ *
+ * @param      turns   The totals.
+ * @param      before  Game state before the operation.
+ * @param      after   Game state after the operation.
+ */
+void turns_apply(LifecounterTurns* turns, const LifecounterModel* before, const LifecounterModel* after);
+
+/**
+ * Most life a player lost in a single turn, the current turn included.
+ */
+uint32_t turns_worst(const LifecounterTurns* turns, size_t player);
+
+/**
+ * Net change of life, positive when more was gained than lost.
+ */
+static inline int32_t turns_net(const LifecounterTurnTotals* totals) {
+    return (int32_t)(totals->gained - totals->damage);
+}
+
+/**
+ * Summary to store with a finished match.
+ *
+ * @param      turns   The totals of the match.
+ * @param      model   Final state of the match.
+ * @param      id      Id of the match.
+ * @param      record  The summary.
+ */
+void turns_record(
+    const LifecounterTurns* turns,
+    const LifecounterModel* model,
+    uint32_t id,
+    LifecounterTurnRecord* record);
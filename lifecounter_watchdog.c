@@ -0,0 +1,118 @@
+#include "lifecounter_watchdog.h"
+#include "lifecounter_energy.h"
+
+#if LIFECOUNTER_FEATURE_TRACE
+
+#define TAG "Lifecounter"
+
+typedef struct {
+    File* file;
+    const char* path;
+    LifecounterWatchdogCallback callback;
+    void* context;
+    FuriThreadId dispatcher; // Thread watchdog_init() was called on, the one running the view dispatcher
+    LifecounterStallLog log;
+    atomic_uint total; // Stalls recorded, claimed before an entry is written
+    atomic_uint budget_cycles; // 0 while not watching
+    bool dirty; // The log differs from the card
+} LifecounterWatchdog;
+
+static LifecounterWatchdog watchdog;
+
+void watchdog_init(
+    File* file,
+    const char* path,
+    LifecounterWatchdogCallback callback,
+    void* context) {
+    LifecounterStallLog* log = &watchdog.log;
+
+    watchdog.file = file;
+    watchdog.path = path;
+    watchdog.callback = callback;
+    watchdog.context = context;
+    watchdog.dispatcher = furi_thread_get_current_id();
+    watchdog.dirty = false;
+
+    bool loaded = false;
+    if(storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        loaded = storage_file_read(file, log, sizeof(LifecounterStallLog)) == sizeof(LifecounterStallLog) &&
+                 log->magic == WATCHDOG_MAGIC && log->budget_ms > 0;
+    }
+    storage_file_close(file);
+    if(!loaded) {
+        memset(log, 0, sizeof(LifecounterStallLog));
+        log->magic = WATCHDOG_MAGIC;
+        log->budget_ms = WATCHDOG_DEFAULT_BUDGET_MS;
+    }
+
+    atomic_store(&watchdog.total, log->total);
+    watchdog_set_budget(log->budget_ms);
+    watchdog.dirty = !loaded;
+}
+
+void watchdog_deinit(void) {
+    LifecounterStallLog* log = &watchdog.log;
+
+    atomic_store(&watchdog.budget_cycles, 0);
+    if(log->total != atomic_load(&watchdog.total)) {
+        log->total = atomic_load(&watchdog.total);
+        watchdog.dirty = true;
+    }
+    if(!watchdog.dirty) {
+        return;
+    }
+
+    if(storage_file_open(watchdog.file, watchdog.path, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        size_t written = storage_file_write(watchdog.file, log, sizeof(LifecounterStallLog));
+        energy_count_sd_written(written);
+        if(written != sizeof(LifecounterStallLog)) {
+            FURI_LOG_E(TAG, "Failed to write to file");
+        }
+    } else {
+        FURI_LOG_E(TAG, "Failed to open file: %s", watchdog.path);
+    }
+    storage_file_close(watchdog.file);
+}
+
+void watchdog_span(LifecounterTracePoint point, uint32_t cycles) {
+    uint32_t budget = atomic_load_explicit(&watchdog.budget_cycles, memory_order_relaxed);
+    if(budget == 0 || cycles <= budget) {
+        return;
+    }
+    // Drawing is only done by the GUI thread, any other point counts on the dispatcher thread only.
+    // The worker, the stress run and the soak checker flush journals and tick on threads nothing waits for.
+    if(point != TracePointMainDraw && furi_thread_get_current_id() != watchdog.dispatcher) {
+        return;
+    }
+
+    uint32_t index = atomic_fetch_add(&watchdog.total, 1);
+    LifecounterStall* stall = &watchdog.log.entries[index % WATCHDOG_LOG_ENTRIES];
+    stall->timestamp = furi_hal_rtc_get_timestamp();
+    stall->duration_us = cycles / furi_hal_cortex_instructions_per_microsecond();
+    stall->point = point;
+
+    if(watchdog.log.flash && watchdog.callback) {
+        watchdog.callback(watchdog.context);
+    }
+}
+
+void watchdog_set_budget(uint16_t budget_ms) {
+    watchdog.log.budget_ms = budget_ms;
+    watchdog.dirty = true;
+    atomic_store(&watchdog.budget_cycles, budget_ms * 1000UL * furi_hal_cortex_instructions_per_microsecond());
+}
+
+void watchdog_set_flash(bool flash) {
+    watchdog.log.flash = flash;
+    watchdog.dirty = true;
+}
+
+const LifecounterStallLog* watchdog_get_log(void) {
+    return &watchdog.log;
+}
+
+uint32_t watchdog_stalls(void) {
+    return atomic_load(&watchdog.total);
+}
+
+#endif
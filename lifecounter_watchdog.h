@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <furi.h>
+#include <storage/storage.h>
+#include "lifecounter_trace.h"
+
+#define WATCHDOG_LOG_ENTRIES 16 // Stalls kept in the log, the oldest are overwritten
+#define WATCHDOG_MAGIC 0x5744434CUL // "LCDW" read as little endian
+#define WATCHDOG_DEFAULT_BUDGET_MS 16
+
+/**
+ * A callback that ran over its budget.
+ */
+typedef struct {
+    uint32_t timestamp; // RTC timestamp when it ended
+    uint32_t duration_us;
+    uint8_t point; // LifecounterTracePoint
+    uint8_t reserved[3];
+} LifecounterStall;
+
+/**
+ * The stall log as stored on the SD card.
+ */
+typedef struct {
+    uint32_t magic;
+    uint16_t budget_ms; // Time a callback may take
+    uint8_t flash; // Flash the LED on a stall
+    uint8_t reserved;
+    uint32_t total; // Stalls recorded ever, the latest is entries[(total - 1) % WATCHDOG_LOG_ENTRIES]
+    LifecounterStall entries[WATCHDOG_LOG_ENTRIES];
+} LifecounterStallLog;
+
+/**
+ * Called on the thread that stalled, after the stall was logged.
+ */
+typedef void (*LifecounterWatchdogCallback)(void* context);
+
+#if LIFECOUNTER_FEATURE_TRACE
+
+/**
+ * Load the stall log and start watching.
+ *
+ * @details    Every traced span of the thread running the view dispatcher, which must be the one
+ *             calling this, and the draws of the GUI thread are checked against the budget as they
+ *             end. Spans of the worker, the stress run, the soak checker and the timer thread are left
+ *             out as the screen doesn't wait for them. A stall is added to the log in RAM, the log is
+ *             written back to the card by watchdog_deinit() so nothing is written while the app is
+ *             being used.
+ * @param      file      File handle for loading and saving the log.
+ * @param      path      Log file, must outlive the watchdog.
+ * @param      callback  Called on a stall when flashing is on, may be NULL.
+ * @param      context   Context for the callback.
+ */
+void watchdog_init(
+    File* file,
+    const char* path,
+    LifecounterWatchdogCallback callback,
+    void* context);
+
+/**
+ * Stop watching and save the log if it changed.
+ */
+void watchdog_deinit(void);
+
+/**
+ * Check a span that just ended against the budget, called by trace_end().
+ */
+void watchdog_span(LifecounterTracePoint point, uint32_t cycles);
+
+void watchdog_set_budget(uint16_t budget_ms);
+
+void watchdog_set_flash(bool flash);
+
+/**
+ * The log, stalls are added to it while it is read. Its total is only brought up to date when it is saved.
+ */
+const LifecounterStallLog* watchdog_get_log(void);
+
+/**
+ * Stalls recorded ever, including those of earlier sessions.
+ */
+uint32_t watchdog_stalls(void);
+
+#endif
@@ -0,0 +1,69 @@
+#include "lifecounter_features.h"
+#include "lifecounter_worker.h"
+#include "lifecounter_trace.h"
+
+#if LIFECOUNTER_FEATURE_HISTORY || LIFECOUNTER_FEATURE_TRACE
+
+#define TAG "Lifecounter"
+#define WORKER_STACK_SIZE 2048
+#define WORKER_POLL_MS 100 // How often an idle worker checks for stop
+
+typedef struct {
+    LifecounterWorkerStep step;
+    void* context;
+} LifecounterWorkerJob;
+
+static int32_t worker_thread(void* context) {
+    LifecounterWorker* worker = context;
+    LifecounterWorkerJob job;
+
+    while(!atomic_load(&worker->stop)) {
+        if(furi_message_queue_get(worker->queue, &job, WORKER_POLL_MS) != FuriStatusOk) {
+            continue;
+        }
+
+        atomic_store(&worker->busy, true);
+        while(!atomic_load(&worker->stop)) {
+            uint32_t trace_start = trace_begin();
+            bool more = job.step(job.context);
+            trace_end(TracePointWorkerStep, trace_start);
+            atomic_fetch_add(&worker->steps, 1);
+            if(!more) {
+                atomic_fetch_add(&worker->jobs, 1);
+                break;
+            }
+            furi_delay_ms(WORKER_SLICE_PAUSE_MS);
+        }
+        atomic_store(&worker->busy, false);
+    }
+    return 0;
+}
+
+void worker_init(LifecounterWorker* worker) {
+    atomic_init(&worker->stop, false);
+    atomic_init(&worker->busy, false);
+    atomic_init(&worker->steps, 0);
+    atomic_init(&worker->jobs, 0);
+    worker->queue = furi_message_queue_alloc(WORKER_QUEUE_SIZE, sizeof(LifecounterWorkerJob));
+    worker->thread = furi_thread_alloc_ex("LifecounterWorker", WORKER_STACK_SIZE, worker_thread, worker);
+    furi_thread_set_priority(worker->thread, FuriThreadPriorityLow);
+    furi_thread_start(worker->thread);
+}
+
+void worker_deinit(LifecounterWorker* worker) {
+    atomic_store(&worker->stop, true);
+    furi_thread_join(worker->thread);
+    furi_thread_free(worker->thread);
+    furi_message_queue_free(worker->queue);
+}
+
+bool worker_post(LifecounterWorker* worker, LifecounterWorkerStep step, void* context) {
+    LifecounterWorkerJob job = {.step = step, .context = context};
+    if(furi_message_queue_put(worker->queue, &job, 0) != FuriStatusOk) {
+        FURI_LOG_W(TAG, "Worker queue full");
+        return false;
+    }
+    return true;
+}
+
+#endif
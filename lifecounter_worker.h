@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <furi.h>
+
+#define WORKER_QUEUE_SIZE 4
+#define WORKER_SLICE_PAUSE_MS 20 // Pause between steps, lets the GUI and storage threads in
+
+/**
+ * Run one small step of a job.
+ *
+ * @return     true while the job has more steps to run.
+ */
+typedef bool (*LifecounterWorkerStep)(void* context);
+
+/**
+ * Low priority thread for slow storage work such as compaction.
+ *
+ * @details    Jobs are split into steps that each do a bounded amount of I/O, the worker pauses
+ *             between steps so the card is never held for long and the GUI never waits on a job.
+ *             Jobs run one after another in the order they were posted.
+ */
+typedef struct {
+    FuriThread* thread;
+    FuriMessageQueue* queue;
+    atomic_bool stop;
+    atomic_bool busy; // A job is running
+    atomic_uint steps; // Steps run since startup
+    atomic_uint jobs; // Jobs completed since startup
+} LifecounterWorker;
+
+void worker_init(LifecounterWorker* worker);
+
+/**
+ * Stop the worker after the step in progress and wait for it. Unfinished jobs are dropped.
+ */
+void worker_deinit(LifecounterWorker* worker);
+
+/**
+ * Queue a job.
+ *
+ * @return     true if the job was queued.
+ */
+bool worker_post(LifecounterWorker* worker, LifecounterWorkerStep step, void* context);
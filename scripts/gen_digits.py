@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""
+Generate the seven segment digit sprites used for life totals into images/.
+
+Each glyph is its own 1-bit PNG so that fap_icon_assets compiles them into icons. The glyph widths
+are part of the file names and are mirrored by the width tables in lifecounter_digits.c, rerun this
+script and update both when changing the geometry.
+
+Usage: python3 scripts/gen_digits.py
+"""
+
+import os
+import struct
+import zlib
+
+# name, digit width, height, stroke
+TIERS = [
+    ("Large", 14, 22, 3),
+    ("Small", 10, 16, 2),
+]
+
+SEGMENTS = {
+    "0": "abcdef",
+    "2": "abdeg",
+    "3": "abcdg",
+    "4": "bcfg",
+    "5": "acdfg",
+    "6": "acdefg",
+    "7": "abc",
+    "8": "abcdefg",
+    "9": "abcdfg",
+}
+
+IMAGES_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "images")
+
+
+def write_png(path, pixels, width, height):
+    """Write a 1-bit grayscale PNG, pixels[y][x] is True for ink (black)."""
+    raw = b""
+    for row in pixels:
+        raw += b"\x00"
+        for offset in range(0, width, 8):
+            byte = 0xFF
+            for bit in range(8):
+                x = offset + bit
+                if x < width and row[x]:
+                    byte &= ~(0x80 >> bit)
+            raw += bytes([byte & 0xFF])
+
+    def chunk(kind, data):
+        body = kind + data
+        return struct.pack(">I", len(data)) + body + struct.pack(">I", zlib.crc32(body))
+
+    header = struct.pack(">IIBBBBB", width, height, 1, 0, 0, 0, 0)
+    with open(path, "wb") as png:
+        png.write(b"\x89PNG\r\n\x1a\n")
+        png.write(chunk(b"IHDR", header))
+        png.write(chunk(b"IDAT", zlib.compress(raw, 9)))
+        png.write(chunk(b"IEND", b""))
+
+
+def fill(pixels, x0, y0, x1, y1):
+    for y in range(y0, y1):
+        for x in range(x0, x1):
+            pixels[y][x] = True
+
+
+def seven_segment(segments, width, height, stroke):
+    pixels = [[False] * width for _ in range(height)]
+    middle = (height - stroke) // 2
+    if "a" in segments:
+        fill(pixels, 0, 0, width, stroke)
+    if "b" in segments:
+        fill(pixels, width - stroke, 0, width, middle + stroke)
+    if "c" in segments:
+        fill(pixels, width - stroke, middle, width, height)
+    if "d" in segments:
+        fill(pixels, 0, height - stroke, width, height)
+    if "e" in segments:
+        fill(pixels, 0, middle, stroke, height)
+    if "f" in segments:
+        fill(pixels, 0, 0, stroke, middle + stroke)
+    if "g" in segments:
+        fill(pixels, 0, middle, width, middle + stroke)
+    return pixels
+
+
+def main():
+    for tier, width, height, stroke in TIERS:
+        for digit, segments in SEGMENTS.items():
+            pixels = seven_segment(segments, width, height, stroke)
+            write_png(os.path.join(IMAGES_DIR, f"{tier}Digit{digit}_{width}x{height}.png"), pixels, width, height)
+
+        # One is narrow: a single bar with a small flag on the top left
+        one_width = stroke * 2
+        pixels = [[False] * one_width for _ in range(height)]
+        fill(pixels, stroke, 0, one_width, height)
+        fill(pixels, 0, stroke, stroke, stroke * 2)
+        write_png(os.path.join(IMAGES_DIR, f"{tier}Digit1_{one_width}x{height}.png"), pixels, one_width, height)
+
+        minus_width = width * 2 // 3
+        pixels = seven_segment("g", minus_width, height, stroke)
+        write_png(os.path.join(IMAGES_DIR, f"{tier}Minus_{minus_width}x{height}.png"), pixels, minus_width, height)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+"""
+Measure input to frame latency on the device through the lifecounter CLI command.
+
+The app must be running with the diagnostics feature (see lifecounter_remote.h) and showing the
+life screen. Each press is injected with "lifecounter press <key>", which waits for the frame showing
+its update and prints the cycle counter when the press was sent, received by the view, applied to the
+game and drawn. The script collects these over many presses and prints the latency distribution of
+every stage in microseconds. Up and down presses alternate so the life totals end where they started.
+
+Usage: python3 scripts/latency_probe.py --port /dev/ttyACM0 [--presses N] [--keys up,down] [--csv PATH]
+       python3 scripts/latency_probe.py --self-test
+"""
+
+import argparse
+import csv
+import os
+import re
+import select
+import sys
+import termios
+import threading
+import tty
+
+PROMPT = b">: "
+CYCLE_WRAP = 1 << 32
+
+# name, first timestamp, second timestamp
+STAGES = [
+    ("sent to input", "sent", "input"),
+    ("input to update", "input", "update"),
+    ("update to frame", "update", "frame"),
+    ("sent to frame", "sent", "frame"),
+]
+
+PRESS_LINE = re.compile(r"press seq=(\d+) sent=(\d+)(?: input=(\d+) update=(\d+) frame=(\d+)| timeout)")
+
+
+class Cli:
+    """Line based access to the Flipper CLI on a serial device or pty."""
+
+    def __init__(self, path, timeout=2.0):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        termios.tcflush(self.fd, termios.TCIOFLUSH)
+        self.timeout = timeout
+        self.buffer = b""
+        # Wake the CLI and skip the banner and every prompt printed so far
+        os.write(self.fd, b"\r")
+        self.read_until_prompt()
+        while select.select([self.fd], [], [], 0.2)[0]:
+            os.read(self.fd, 4096)
+        self.buffer = b""
+
+    def close(self):
+        os.close(self.fd)
+
+    def read_until_prompt(self):
+        while PROMPT not in self.buffer:
+            ready, _, _ = select.select([self.fd], [], [], self.timeout)
+            if not ready:
+                raise TimeoutError("no CLI prompt within %.1f s" % self.timeout)
+            self.buffer += os.read(self.fd, 4096)
+        output, _, self.buffer = self.buffer.partition(PROMPT)
+        return output.decode(errors="replace")
+
+    def command(self, line):
+        """Run a command and return its output lines without the echo."""
+        os.write(self.fd, line.encode() + b"\r")
+        lines = [l.strip() for l in self.read_until_prompt().splitlines()]
+        return [l for l in lines if l and l != line]
+
+
+def elapsed(start, end):
+    """Cycles between two counter values, the counter wraps at 32 bits."""
+    return (end - start) % CYCLE_WRAP
+
+
+def percentile(values, fraction):
+    """Nearest rank percentile of sorted values."""
+    index = max(0, min(len(values) - 1, int(round(fraction * len(values) + 0.5)) - 1))
+    return values[index]
+
+
+def probe(cli, presses, keys):
+    """Send the presses and return cycles per microsecond, samples and the number of timeouts."""
+    info = [l for l in cli.command("lifecounter info") if l.startswith("info ")]
+    if not info:
+        sys.exit("the app doesn't answer, is it running with diagnostics enabled?")
+    cycles_per_us = int(info[0].split("cycles_per_us=")[1])
+
+    samples = []
+    timeouts = 0
+    for i in range(presses):
+        key = keys[i % len(keys)]
+        lines = [l for l in cli.command("lifecounter press %s" % key) if l.startswith("press ")]
+        match = PRESS_LINE.match(lines[0]) if lines else None
+        if not match:
+            sys.exit("unexpected answer to press: %r" % lines)
+        if match.group(3) is None:
+            timeouts += 1
+            continue
+        sent, received, updated, drawn = (int(match.group(g)) for g in (2, 3, 4, 5))
+        samples.append({"key": key, "sent": sent, "input": received, "update": updated, "frame": drawn})
+    return cycles_per_us, samples, timeouts
+
+
+def report(cycles_per_us, samples, timeouts):
+    print("| Stage | n | min us | p50 us | p90 us | p99 us | max us |")
+    print("|---|---:|---:|---:|---:|---:|---:|")
+    rows = {}
+    for name, start, end in STAGES:
+        values = sorted(elapsed(s[start], s[end]) / cycles_per_us for s in samples)
+        if not values:
+            continue
+        row = (values[0], percentile(values, 0.5), percentile(values, 0.9), percentile(values, 0.99), values[-1])
+        rows[name] = row
+        print("| %s | %d | %s |" % (name, len(values), " | ".join("%.0f" % v for v in row)))
+    print("\n%d presses, %d without a frame" % (len(samples) + timeouts, timeouts))
+    return rows
+
+
+def write_csv(path, cycles_per_us, samples):
+    with open(path, "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(["key"] + [name for name, _, _ in STAGES])
+        for s in samples:
+            writer.writerow([s["key"]] + ["%.1f" % (elapsed(s[a], s[b]) / cycles_per_us) for _, a, b in STAGES])
+
+
+class FakeFlipper(threading.Thread):
+    """Stand-in for the device on the master side of a pty, answers with known latencies."""
+
+    CYCLES_PER_US = 64
+    LATENCY_US = {"input": 300, "update": 50, "frame": 8000}
+    TIMEOUT_EVERY = 50
+
+    def __init__(self, fd):
+        super().__init__(daemon=True)
+        self.fd = fd
+        # Start close to the wrap of the counter so the elapsed math is exercised
+        self.cycles = CYCLE_WRAP - 1000 * self.CYCLES_PER_US
+        self.presses = 0
+
+    def answer(self, line):
+        if line == "lifecounter info":
+            return "info cycles_per_us=%d\r\n" % self.CYCLES_PER_US
+        if line.startswith("lifecounter press "):
+            self.presses += 1
+            sent = self.cycles
+            if self.presses % self.TIMEOUT_EVERY == 0:
+                return "press seq=%d sent=%d timeout\r\n" % (self.presses, sent)
+            received = sent + self.LATENCY_US["input"] * self.CYCLES_PER_US
+            updated = received + self.LATENCY_US["update"] * self.CYCLES_PER_US
+            drawn = updated + self.LATENCY_US["frame"] * self.CYCLES_PER_US
+            self.cycles = (drawn + 12345) % CYCLE_WRAP
+            return "press seq=%d sent=%d input=%d update=%d frame=%d\r\n" % (
+                self.presses,
+                sent,
+                received % CYCLE_WRAP,
+                updated % CYCLE_WRAP,
+                drawn % CYCLE_WRAP,
+            )
+        return "" if not line else "could not find command `%s`\r\n" % line
+
+    def run(self):
+        os.write(self.fd, b"Welcome to Flipper Zero Command Line Interface!\r\n\r\n" + PROMPT)
+        pending = b""
+        while True:
+            try:
+                pending += os.read(self.fd, 1024)
+            except OSError:
+                return
+            while b"\r" in pending:
+                line, _, pending = pending.partition(b"\r")
+                line = line.decode().strip()
+                os.write(self.fd, (line + "\r\n" + self.answer(line)).encode() + b"\r\n" + PROMPT)
+
+
+def self_test():
+    """Run the probe against a pty stand-in and check the reported latencies."""
+    master, slave = os.openpty()
+    device = FakeFlipper(master)
+    device.start()
+    cli = Cli(os.ttyname(slave))
+    presses = 500
+    cycles_per_us, samples, timeouts = probe(cli, presses, ["up", "down"])
+    cli.close()
+    os.close(slave)
+
+    rows = report(cycles_per_us, samples, timeouts)
+    expected = dict(device.LATENCY_US)
+    expected_rows = {
+        "sent to input": expected["input"],
+        "input to update": expected["update"],
+        "update to frame": expected["frame"],
+        "sent to frame": expected["input"] + expected["update"] + expected["frame"],
+    }
+    assert cycles_per_us == device.CYCLES_PER_US
+    assert timeouts == presses // device.TIMEOUT_EVERY, timeouts
+    assert len(samples) == presses - timeouts
+    for name, value in expected_rows.items():
+        assert all(v == value for v in rows[name]), (name, rows[name])
+    print("self-test passed")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", help="serial device of the Flipper CLI, for example /dev/ttyACM0")
+    parser.add_argument("--presses", type=int, default=1000, help="presses to send (default 1000)")
+    parser.add_argument("--keys", default="up,down", help="keys to cycle through (default up,down)")
+    parser.add_argument("--csv", help="also write every sample to this file")
+    parser.add_argument("--self-test", action="store_true", help="run against a simulated device on a pty")
+    args = parser.parse_args()
+
+    if args.self_test:
+        self_test()
+        return
+    if not args.port:
+        parser.error("--port is required")
+
+    cli = Cli(args.port)
+    try:
+        cycles_per_us, samples, timeouts = probe(cli, args.presses, args.keys.split(","))
+    finally:
+        cli.close()
+    report(cycles_per_us, samples, timeouts)
+    if args.csv:
+        write_csv(args.csv, cycles_per_us, samples)
+
+
+if __name__ == "__main__":
+    main()
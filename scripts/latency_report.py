@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""
+Print the latency histograms the app keeps across sessions.
+
+The app merges the histograms of every session into latency.bin in its data folder when it exits
+(see lifecounter_histogram.h). Copy the file off the SD card, for example with qFlipper, and pass one
+or more copies to compare them, such as the files from before and after a firmware update.
+
+Usage: python3 scripts/latency_report.py latency.bin [older_latency.bin ...]
+"""
+
+import argparse
+import datetime
+import struct
+import sys
+
+MAGIC = 0x4748434C
+HEADER = struct.Struct("<IBBHIII")
+NAMES = ["input_to_frame", "draw", "storage"]
+
+
+def bucket_upper(bucket, sub_bits):
+    """Largest value in a bucket, mirrors histogram_bucket_upper()."""
+    if bucket < (1 << sub_bits):
+        return bucket
+    shift = (bucket >> sub_bits) - 1
+    mantissa = (1 << sub_bits) + (bucket & ((1 << sub_bits) - 1))
+    return ((mantissa + 1) << shift) - 1
+
+
+def percentile(counts, max_us, sub_bits, fraction):
+    total = sum(counts)
+    if total == 0:
+        return 0
+    rank = -(-total * fraction // 1)
+    seen = 0
+    for bucket, count in enumerate(counts):
+        seen += count
+        if count and seen >= rank:
+            return min(bucket_upper(bucket, sub_bits), max_us)
+    return max_us
+
+
+def read(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    magic, sub_bits, histograms, buckets, sessions, first, last = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        sys.exit("%s is not a latency histogram file" % path)
+    record = struct.Struct("<I%dI" % buckets)
+    result = []
+    for h in range(histograms):
+        values = record.unpack_from(data, HEADER.size + h * record.size)
+        name = NAMES[h] if h < len(NAMES) else "histogram %d" % h
+        result.append((name, values[0], list(values[1:])))
+    return sub_bits, sessions, first, last, result
+
+
+def when(timestamp):
+    # The RTC runs on local time, so the timestamp is shown as is
+    return datetime.datetime.fromtimestamp(timestamp, datetime.timezone.utc).strftime("%Y-%m-%d %H:%M")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("files", nargs="+", help="latency.bin files")
+    args = parser.parse_args()
+
+    print("| File | Sessions | From | To | Histogram | n | p50 us | p90 us | p99 us | max us |")
+    print("|---|---:|---|---|---|---:|---:|---:|---:|---:|")
+    for path in args.files:
+        sub_bits, sessions, first, last, histograms = read(path)
+        for name, max_us, counts in histograms:
+            print(
+                "| %s | %d | %s | %s | %s | %d | %d | %d | %d | %d |"
+                % (
+                    path,
+                    sessions,
+                    when(first),
+                    when(last),
+                    name,
+                    sum(counts),
+                    percentile(counts, max_us, sub_bits, 0.5),
+                    percentile(counts, max_us, sub_bits, 0.9),
+                    percentile(counts, max_us, sub_bits, 0.99),
+                    max_us,
+                )
+            )
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""
+Build the feature variants of the app and report their section sizes.
+
+Each variant is built with ufbt from a copy of the app whose application.fam has the feature switches
+(see lifecounter_features.h) rewritten. The sizes of the resulting .fap are read with
+arm-none-eabi-size and printed as a markdown table, text is code and constants, data and bss are the
+RAM the app needs once loaded.
+
+Usage: python3 scripts/size_report.py [--variant NAME ...] [--size PATH]
+"""
+
+import argparse
+import glob
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+APP_DIR = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+
+FEATURES = ["AUDIO", "HISTORY", "SPLASH", "DIAGNOSTICS", "TRACE", "FAULTS"]
+
+# name, features turned off
+VARIANTS = [
+    ("full", []),
+    ("no-audio", ["AUDIO"]),
+    ("no-history", ["HISTORY"]),
+    ("no-splash", ["SPLASH"]),
+    ("no-diagnostics", ["DIAGNOSTICS"]),
+    ("no-trace", ["TRACE"]),
+    ("no-faults", ["FAULTS"]),
+    ("tournament", FEATURES),
+]
+
+SKIP = shutil.ignore_patterns(".git", "dist", "_gate_build", "__pycache__")
+
+
+def find_size_tool():
+    """arm-none-eabi-size from the PATH or the toolchain ufbt downloaded."""
+    tool = shutil.which("arm-none-eabi-size")
+    if tool:
+        return tool
+    ufbt_home = os.environ.get("UFBT_HOME", os.path.expanduser("~/.ufbt"))
+    found = glob.glob(os.path.join(ufbt_home, "toolchain", "*", "bin", "arm-none-eabi-size"))
+    return found[0] if found else None
+
+
+def write_manifest(path, disabled):
+    with open(path) as f:
+        manifest = f.read()
+    for feature in FEATURES:
+        value = 0 if feature in disabled else 1
+        manifest, count = re.subn(
+            r'"LIFECOUNTER_FEATURE_%s=\d"' % feature,
+            '"LIFECOUNTER_FEATURE_%s=%d"' % (feature, value),
+            manifest,
+        )
+        if count != 1:
+            sys.exit("application.fam has no switch for %s" % feature)
+    with open(path, "w") as f:
+        f.write(manifest)
+
+
+def build_variant(work_dir, disabled):
+    """Build a variant and return the path of its .fap."""
+    shutil.rmtree(work_dir, ignore_errors=True)
+    shutil.copytree(APP_DIR, work_dir, ignore=SKIP)
+    write_manifest(os.path.join(work_dir, "application.fam"), disabled)
+    subprocess.run(["ufbt"], cwd=work_dir, check=True, stdout=subprocess.DEVNULL)
+    faps = glob.glob(os.path.join(work_dir, "dist", "*.fap"))
+    if not faps:
+        sys.exit("ufbt produced no .fap in %s" % work_dir)
+    return faps[0]
+
+
+def section_sizes(size_tool, fap):
+    """text, data and bss of a .fap in the Berkeley format of size."""
+    output = subprocess.run([size_tool, "-B", fap], check=True, capture_output=True, text=True).stdout
+    text, data, bss = output.splitlines()[1].split()[:3]
+    return int(text), int(data), int(bss)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--variant", action="append", help="only build this variant, can be repeated")
+    parser.add_argument("--size", help="path of arm-none-eabi-size")
+    args = parser.parse_args()
+
+    size_tool = args.size or find_size_tool()
+    if not size_tool:
+        sys.exit("arm-none-eabi-size not found, run ufbt once to fetch the toolchain or pass --size")
+
+    variants = [v for v in VARIANTS if not args.variant or v[0] in args.variant]
+    rows = []
+    with tempfile.TemporaryDirectory() as tmp:
+        for name, disabled in variants:
+            print("building %s" % name, file=sys.stderr)
+            fap = build_variant(os.path.join(tmp, name), disabled)
+            rows.append((name, *section_sizes(size_tool, fap), os.path.getsize(fap)))
+
+    full = rows[0] if rows and rows[0][0] == "full" else None
+    print("| Variant | text | data | bss | .fap bytes | vs full |")
+    print("|---|---:|---:|---:|---:|---:|")
+    for name, text, data, bss, fap_bytes in rows:
+        delta = "%+d" % (fap_bytes - full[4]) if full else ""
+        print("| %s | %d | %d | %d | %d | %s |" % (name, text, data, bss, fap_bytes, delta))
+
+
+if __name__ == "__main__":
+    main()